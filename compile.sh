@@ -2,16 +2,40 @@
 
 cur="ggint"
 echo "Compiling ${cur} ... "
-g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur}
+g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur} -lpthread
 
 cur="find_prime"
 echo "Compiling ${cur} ... "
-g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur}
+g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur} -lpthread
 
 cur="find_safe_prime"
 echo "Compiling ${cur} ... "
-g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur}
+g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur} -lpthread
 
 cur="dlp"
 echo "Compiling ${cur} ... "
-g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur}
+g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur} -lpthread
+
+cur="find_dsa_prime"
+echo "Compiling ${cur} ... "
+g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur} -lpthread
+
+cur="factor"
+echo "Compiling ${cur} ... "
+g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur} -lpthread
+
+cur="batch_gcd"
+echo "Compiling ${cur} ... "
+g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur} -lpthread
+
+cur="bulk_prime"
+echo "Compiling ${cur} ... "
+g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur} -lpthread
+
+cur="coordinator"
+echo "Compiling ${cur} ... "
+g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur} -lpthread
+
+cur="gen_cache"
+echo "Compiling ${cur} ... "
+g++ -std=c++11 -O3 -I. examples/${cur}.cpp -o ${cur} -lpthread
@@ -0,0 +1,361 @@
+/*! \file batch_gcd.cpp
+ *  \brief Find the moduli of a corpus that share a prime factor with another modulus (Bernstein's batch GCD)
+ *  \author Georgi Gerganov
+ *
+ *  The product tree multiplies the moduli in pairs, level by level, up to P = N_1*N_2*...*N_k. The remainder tree
+ *  goes back down: every node gets the remainder of its parent mod node^2, so that leaf i ends up with P mod N_i^2.
+ *  Then gcd(N_i, (P mod N_i^2)/N_i) is the product of the primes that N_i shares with the other moduli. This costs a
+ *  few long products and divisions per level instead of k^2 gcds.
+ *
+ *  The moduli are read one per line, decimal or hexadecimal with "0x" prefix, from a file or from stdin. Levels that
+ *  are larger than the memory limit are kept in unlinked temporary files in $TMPDIR (default /tmp) mapped with mmap,
+ *  so that the kernel can write them out. The nodes of a level are split between the threads, and the few long
+ *  nodes near the root use the threads of the multiplication instead.
+ *
+ *  Example:
+ *
+ *      ./batch_gcd moduli.txt 4 1024
+ *
+ */
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ggint.h"
+#include "common.h"
+
+const std::size_t kDigits = 512; // max num : 2^(512*8) = 2^4096
+using TNum = ggint::TNumTmpl<kDigits>;
+
+#ifdef GGINT_WORDS
+
+using ggint::TWord;
+namespace mpn = ggint::mpn;
+
+const std::size_t kWords = kDigits/ggint::kWordDigits;
+
+struct BatchParams {
+    int nthread = 1;
+    std::size_t memLimit = std::size_t(1) << 30; // bytes of a level kept on the heap, 0 - all levels on disk
+    std::string tmpDir = "/tmp";
+};
+
+// Numbers of one tree level, stored back to back
+// Node i has the words [offset[i], offset[i + 1]). A level larger than the memory limit is kept in an unlinked
+// temporary file mapped with mmap instead of the heap
+class TLevel {
+public:
+    TLevel() = default;
+    TLevel(const TLevel &) = delete;
+    TLevel & operator=(const TLevel &) = delete;
+
+    ~TLevel() { release(); }
+
+    std::size_t count() const { return offset.size() - 1; }
+    std::size_t bytes() const { return offset.back()*sizeof(TWord); }
+    bool on_disk() const { return fd >= 0; }
+
+    TWord * node(std::size_t i) { return words + offset[i]; }
+    const TWord * node(std::size_t i) const { return words + offset[i]; }
+    std::size_t len(std::size_t i) const { return offset[i + 1] - offset[i]; }
+
+    // zero nodes of the given lengths
+    bool alloc(const std::vector<std::size_t> & lens, const BatchParams & params) {
+        release();
+        for (auto n : lens) offset.push_back(offset.back() + n);
+
+        if (bytes() <= params.memLimit) {
+            mem.assign(offset.back(), 0);
+            words = mem.data();
+            return true;
+        }
+
+        return create(params) && ftruncate(fd, bytes()) == 0 && map();
+    }
+
+    // add the nodes one by one, then call finish()
+    bool append(const TWord * a, std::size_t n, const BatchParams & params) {
+        if (fd < 0 && (offset.back() + n)*sizeof(TWord) > params.memLimit) {
+            if (create(params) == false || write_all(mem.data(), mem.size()*sizeof(TWord)) == false) return false;
+            std::vector<TWord>().swap(mem);
+        }
+
+        if (fd >= 0) {
+            if (write_all(a, n*sizeof(TWord)) == false) return false;
+        } else {
+            mem.insert(mem.end(), a, a + n);
+        }
+        offset.push_back(offset.back() + n);
+
+        return true;
+    }
+
+    bool finish() {
+        if (fd >= 0) return map();
+        words = mem.data();
+        return true;
+    }
+
+    void release() {
+        if (mapped) munmap(mapped, bytes());
+        if (fd >= 0) close(fd);
+        mapped = nullptr;
+        fd = -1;
+        std::vector<TWord>().swap(mem);
+        words = nullptr;
+        offset.assign(1, 0);
+    }
+
+private:
+    bool create(const BatchParams & params) {
+        std::string path = params.tmpDir + "/ggint-batch-XXXXXX";
+        fd = mkstemp(&path[0]);
+        if (fd < 0) {
+            fprintf(stderr, "Failed to create a temporary file in '%s'\n", params.tmpDir.c_str());
+            return false;
+        }
+        unlink(path.c_str());
+        return true;
+    }
+
+    bool write_all(const void * data, std::size_t n) {
+        const char * p = (const char *) data;
+        while (n > 0) {
+            const auto k = write(fd, p, n);
+            if (k <= 0) return false;
+            p += k;
+            n -= k;
+        }
+        return true;
+    }
+
+    bool map() {
+        void * p = mmap(nullptr, bytes(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) return false;
+        mapped = p;
+        words = (TWord *) p;
+        return true;
+    }
+
+    std::vector<std::size_t> offset {0};
+    std::vector<TWord> mem;
+    TWord * words = nullptr;
+
+    int fd = -1;
+    void * mapped = nullptr;
+};
+
+// call f(i) for the n nodes of a level
+// With enough nodes each thread takes whole nodes, otherwise the nodes are processed one at a time and their long
+// products are split between the threads of the pool
+template <typename F>
+void for_each_node(std::size_t n, int nthread, const F & f) {
+    if (n < (std::size_t) nthread) {
+        ggint::set_num_threads(nthread);
+        for (std::size_t i = 0; i < n; ++i) f(i);
+        return;
+    }
+
+    ggint::set_num_threads(1);
+    std::atomic<std::size_t> next(0);
+    auto worker = [&]() {
+        for (std::size_t i = next++; i < n; i = next++) f(i);
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < nthread; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto & w : workers) {
+        w.join();
+    }
+}
+
+// r = a mod m, m has nm words with m[nm - 1] != 0, r has nm words
+void mod_words(const TWord * a, std::size_t na, const TWord * m, std::size_t nm, TWord * r) {
+    na = mpn::size(a, na);
+    if (na < nm) {
+        std::copy(a, a + na, r);
+        std::fill(r + na, r + nm, 0);
+    } else if (mpn::div_long(na, nm)) {
+        mpn::divrem_long(nullptr, r, a, na, m, nm);
+    } else {
+        std::vector<TWord> u(na + 1, 0), t(nm);
+        std::copy(a, a + na, u.begin());
+        mpn::divrem(nullptr, r, u.data(), na, m, nm, t.data());
+    }
+}
+
+// read the moduli, one per line, lines[i] is the line of modulus i
+bool read_moduli(FILE * f, const BatchParams & params, TLevel & leaves, std::vector<std::size_t> & lines) {
+    std::array<char, 4096> line;
+    std::array<TWord, kWords> w;
+    TNum n;
+    bool complete = true;
+    for (std::size_t iline = 1; read_line(f, line, complete); ++iline) {
+        if (line[0] == '\n') continue;
+        if (complete == false || ggint::parse(line.data(), n) == false || ggint::nbits(n) < 2) {
+            fprintf(stderr, "Skipping invalid modulus on line %zu\n", iline);
+            continue;
+        }
+
+        std::memcpy(w.data(), n.data(), kDigits);
+        if (leaves.append(w.data(), mpn::size(w.data(), kWords), params) == false) return false;
+        lines.push_back(iline);
+    }
+
+    return leaves.finish();
+}
+
+double seconds_since(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+int main(int argc, char ** argv) {
+    printf("Usage: %s [moduli.txt] [nthread] [memMB]\n", argv[0]);
+
+    BatchParams params;
+    params.nthread = std::max(1, (int) std::thread::hardware_concurrency());
+    if (argc > 2) params.nthread = std::max(1, atoi(argv[2]));
+    if (argc > 3) params.memLimit = std::max(0, atoi(argv[3]))*(std::size_t(1) << 20);
+    if (getenv("TMPDIR")) params.tmpDir = getenv("TMPDIR");
+
+    FILE * fin = stdin;
+    if (argc > 1 && strcmp(argv[1], "-") != 0) {
+        fin = fopen(argv[1], "r");
+        if (fin == nullptr) {
+            fprintf(stderr, "Failed to open '%s'\n", argv[1]);
+            return -1;
+        }
+    }
+
+    auto tStart = std::chrono::steady_clock::now();
+
+    // prod[0] are the moduli, prod.back() is their product
+    std::vector<std::unique_ptr<TLevel>> prod;
+    std::vector<std::size_t> lines;
+    prod.emplace_back(new TLevel());
+    const bool ok = read_moduli(fin, params, *prod[0], lines);
+    if (fin != stdin) fclose(fin);
+    if (ok == false) {
+        fprintf(stderr, "Failed to store the moduli\n");
+        return -1;
+    }
+
+    const std::size_t k = prod[0]->count();
+    printf("Read %zu moduli, %.1f MB, %.2f s\n", k, prod[0]->bytes()/1e6, seconds_since(tStart));
+    if (k < 2) return 0;
+
+    tStart = std::chrono::steady_clock::now();
+    while (prod.back()->count() > 1) {
+        const TLevel & lo = *prod.back();
+        const std::size_t n = (lo.count() + 1)/2;
+
+        std::vector<std::size_t> lens(n);
+        for (std::size_t j = 0; j < n; ++j) {
+            lens[j] = lo.len(2*j) + (2*j + 1 < lo.count() ? lo.len(2*j + 1) : 0);
+        }
+
+        std::unique_ptr<TLevel> hi(new TLevel());
+        if (hi->alloc(lens, params) == false) {
+            fprintf(stderr, "Failed to allocate product level %zu\n", prod.size());
+            return -1;
+        }
+        const auto tLevel = std::chrono::steady_clock::now();
+        for_each_node(n, params.nthread, [&](std::size_t j) {
+            if (2*j + 1 < lo.count()) {
+                mpn::mul(hi->node(j), lo.node(2*j), lo.len(2*j), lo.node(2*j + 1), lo.len(2*j + 1));
+            } else {
+                std::copy(lo.node(2*j), lo.node(2*j) + lo.len(2*j), hi->node(j));
+            }
+        });
+
+        printf("Product level %2zu: %8zu nodes, %8.1f MB, %7.2f s%s\n", prod.size(), n, hi->bytes()/1e6, seconds_since(tLevel), hi->on_disk() ? " (on disk)" : "");
+        fflush(stdout);
+        prod.push_back(std::move(hi));
+    }
+    {
+        const TWord * root = prod.back()->node(0);
+        const std::size_t nw = mpn::size(root, prod.back()->len(0));
+        printf("Product tree: %zu bits, %.2f s\n", 64*nw - __builtin_clzll(root[nw - 1]), seconds_since(tStart));
+    }
+
+    // rem[j] = up[j/2] mod prod[lvl][j]^2, starting from the root: P mod P^2 = P
+    tStart = std::chrono::steady_clock::now();
+    std::unique_ptr<TLevel> up = std::move(prod.back());
+    prod.pop_back();
+    for (std::size_t lvl = prod.size(); lvl-- > 0; ) {
+        const TLevel & pl = *prod[lvl];
+
+        std::vector<std::size_t> lens(pl.count());
+        for (std::size_t j = 0; j < lens.size(); ++j) lens[j] = 2*pl.len(j);
+
+        std::unique_ptr<TLevel> rem(new TLevel());
+        if (rem->alloc(lens, params) == false) {
+            fprintf(stderr, "Failed to allocate remainder level %zu\n", lvl);
+            return -1;
+        }
+        const auto tLevel = std::chrono::steady_clock::now();
+        for_each_node(pl.count(), params.nthread, [&](std::size_t j) {
+            std::vector<TWord> m2(2*pl.len(j));
+            mpn::sqr(m2.data(), pl.node(j), pl.len(j));
+            mod_words(up->node(j/2), up->len(j/2), m2.data(), mpn::size(m2.data(), m2.size()), rem->node(j));
+        });
+
+        printf("Remainder level %2zu: %8zu nodes, %8.1f MB, %7.2f s%s\n", lvl, pl.count(), rem->bytes()/1e6, seconds_since(tLevel), rem->on_disk() ? " (on disk)" : "");
+        fflush(stdout);
+        up = std::move(rem);
+        if (lvl > 0) prod.pop_back();
+    }
+    printf("Remainder tree: %.2f s\n", seconds_since(tStart));
+
+    // g_i = gcd(N_i, (P mod N_i^2)/N_i), the quotient is 0 if N_i has only shared primes
+    tStart = std::chrono::steady_clock::now();
+    const TLevel & leaves = *prod[0];
+    std::vector<std::vector<TWord>> shared(k);
+    for_each_node(k, params.nthread, [&](std::size_t i) {
+        const std::size_t n = leaves.len(i);
+        const std::size_t nr = mpn::size(up->node(i), up->len(i));
+        std::vector<TWord> u(std::max(nr, n) + 1, 0), q(nr + 1, 0), r(n), t(n);
+        std::copy(up->node(i), up->node(i) + nr, u.begin());
+        if (nr >= n) mpn::divrem(q.data(), r.data(), u.data(), nr, leaves.node(i), n, t.data());
+        q.resize(n);
+
+        std::vector<TWord> g(leaves.node(i), leaves.node(i) + n);
+        if (mpn::size(q.data(), n) > 0) {
+            std::vector<TWord> v(g);
+            mpn::gcd(g.data(), q.data(), v.data(), n);
+        }
+        if (mpn::size(g.data(), n) > 1 || g[0] != 1) shared[i].swap(g);
+    });
+    ggint::set_num_threads(1);
+    printf("GCDs: %.2f s\n", seconds_since(tStart));
+
+    std::size_t nshared = 0;
+    TNum g;
+    for (std::size_t i = 0; i < k; ++i) {
+        if (shared[i].empty()) continue;
+        ++nshared;
+
+        ggint::zero(g);
+        std::memcpy(g.data(), shared[i].data(), shared[i].size()*sizeof(TWord));
+        const bool all = shared[i].size() == leaves.len(i) && std::equal(shared[i].begin(), shared[i].end(), leaves.node(i));
+        printf("line %zu: %s%s\n", lines[i], ggint::to_string(g).c_str(), all ? " (all factors shared)" : "");
+    }
+    printf("%zu of %zu moduli share a factor\n", nshared, k);
+
+    return 0;
+}
+
+#else
+
+int main(int, char ** argv) {
+    printf("%s needs the word level arithmetic, which is disabled in this build\n", argv[0]);
+    return -1;
+}
+
+#endif
@@ -0,0 +1,228 @@
+/*! \file bulk_prime.cpp
+ *  \brief Primality test of many numbers given as a binary file or as text lines on stdin
+ *  \author Georgi Gerganov
+ */
+
+#include <array>
+#include <limits>
+#include <chrono>
+#include <vector>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ggint.h"
+#include "common.h"
+
+// numbers processed at once - bounds the memory used for copies and results
+const std::size_t kChunk = 1 << 16;
+
+// sieve
+std::vector<std::size_t> smallPrimes;
+
+void add_prime(std::size_t n) {
+    for (auto p : smallPrimes) {
+        if (p*p > n) break;
+        if (n%p == 0) return;
+    }
+    smallPrimes.push_back(n);
+}
+
+void calc_small_primes(std::size_t n) {
+    smallPrimes.clear();
+    smallPrimes.push_back(2);
+    for (auto k = 3; k < n; ++k) {
+        add_prime(k);
+    }
+}
+
+struct Params {
+    int nthread = 1;
+    int nbits = 512;
+    std::size_t trials = 0;
+    std::size_t width = 0;
+};
+
+// write one result per number: '1' - prime, '0' - composite, '?' - invalid or too big
+void write_results(const uint8_t * res, const std::vector<bool> & bad, std::size_t count, std::size_t & nprime) {
+    std::string out(2*count, '\n');
+    for (std::size_t i = 0; i < count; ++i) {
+        out[2*i] = bad[i] ? '?' : (res[i] ? '1' : '0');
+        nprime += (bad[i] == false && res[i]);
+    }
+    fwrite(out.data(), 1, out.size(), stdout);
+}
+
+// records of width bytes, little-endian
+// when a record has exactly the layout of TNumTmpl<Size> the mapped data is tested in place
+template <std::size_t Size>
+std::size_t run_file(const uint8_t * data, std::size_t nrec, const Params & params, std::size_t & nprime) {
+    using TNum = ggint::TNumTmpl<Size>;
+    static_assert(sizeof(TNum) == Size, "TNumTmpl is expected to be a plain array of digits");
+
+    const bool inplace = params.width == Size;
+    fprintf(stderr, "Testing %zu numbers as %zu-byte integers (%s)\n", nrec, Size, inplace ? "zero-copy" : "copy");
+
+    std::vector<TNum> buf(inplace ? 0 : std::min(nrec, kChunk));
+    std::vector<uint8_t> res(std::min(nrec, kChunk));
+    std::vector<bool> bad(std::min(nrec, kChunk));
+
+    for (std::size_t i0 = 0; i0 < nrec; i0 += kChunk) {
+        const std::size_t count = std::min(kChunk, nrec - i0);
+        const uint8_t * src = data + i0*params.width;
+
+        const TNum * nums = reinterpret_cast<const TNum *>(src);
+        if (inplace == false) {
+            for (std::size_t i = 0; i < count; ++i) {
+                ggint::zero(buf[i]);
+                std::copy(src + i*params.width, src + (i + 1)*params.width, buf[i].begin());
+            }
+            nums = buf.data();
+        }
+
+        for (std::size_t i = 0; i < count; ++i) {
+            bad[i] = ggint::nbits(nums[i]) > (std::size_t) params.nbits;
+        }
+
+        is_prime_bulk(nums, count, res.data(), smallPrimes, params.trials, params.nthread);
+        write_results(res.data(), bad, count, nprime);
+    }
+
+    return nrec;
+}
+
+// one decimal or hexadecimal ("0x" prefix) number per line
+template <std::size_t Size>
+std::size_t run_stream(FILE * fin, const Params & params, std::size_t & nprime) {
+    using TNum = ggint::TNumTmpl<Size>;
+
+    fprintf(stderr, "Testing numbers from stdin as %zu-byte integers\n", Size);
+
+    std::vector<TNum> buf(kChunk);
+    std::vector<uint8_t> res(kChunk);
+    std::vector<bool> bad(kChunk);
+
+    std::size_t ntotal = 0;
+    std::array<char, 4096> line;
+    bool eof = false;
+    while (eof == false) {
+        std::size_t count = 0;
+        while (count < kChunk) {
+            bool complete = true;
+            if (read_line(fin, line, complete) == false) {
+                eof = true;
+                break;
+            }
+            bad[count] = complete == false || ggint::parse(line.data(), buf[count]) == false ||
+                ggint::nbits(buf[count]) > (std::size_t) params.nbits;
+            if (bad[count]) {
+                ggint::zero(buf[count]);
+            }
+            ++count;
+        }
+
+        is_prime_bulk(buf.data(), count, res.data(), smallPrimes, params.trials, params.nthread);
+        write_results(res.data(), bad, count, nprime);
+        ntotal += count;
+    }
+
+    return ntotal;
+}
+
+template <std::size_t Size>
+std::size_t run(const uint8_t * data, std::size_t nrec, const Params & params, std::size_t & nprime) {
+    return data ? run_file<Size>(data, nrec, params, nprime) : run_stream<Size>(stdin, params, nprime);
+}
+
+int main(int argc, char ** argv) {
+    fprintf(stderr, "Usage: %s nthread nbits [file width]\n", argv[0]);
+    fprintf(stderr, "    nthread - number of threads\n");
+    fprintf(stderr, "    nbits   - max number of bits of the tested numbers\n");
+    fprintf(stderr, "    file    - binary file with little-endian numbers, each stored in width bytes\n");
+    fprintf(stderr, "              width defaults to (nbits + 7)/8, widths 16, 32, 64, 128 and 256 are tested in place\n");
+    fprintf(stderr, "              without file, numbers are read from stdin, one per line\n");
+
+    srand(time(0));
+
+    Params params;
+    if (argc > 1) {
+        params.nthread = std::max(1, atoi(argv[1]));
+    }
+    if (argc > 2) {
+        params.nbits = std::max(8, std::min(1024, atoi(argv[2])));
+    }
+    params.trials = std::max(10, params.nbits/16);
+
+    const char * fname = argc > 3 ? argv[3] : nullptr;
+    if (fname) {
+        params.width = argc > 4 ? atoi(argv[4]) : (params.nbits + 7)/8;
+        if (params.width == 0 || params.width > 256) {
+            fprintf(stderr, "Invalid record width %zu\n", params.width);
+            return -1;
+        }
+    }
+
+    calc_small_primes(1 << 12);
+
+    const uint8_t * data = nullptr;
+    std::size_t nrec = 0;
+    std::size_t mapsize = 0;
+    if (fname) {
+        int fd = open(fname, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Failed to open '%s'\n", fname);
+            return -1;
+        }
+        struct stat st;
+        fstat(fd, &st);
+        mapsize = st.st_size;
+        nrec = mapsize/params.width;
+        if (mapsize % params.width != 0) {
+            fprintf(stderr, "Warning: ignoring %zu trailing bytes\n", mapsize % params.width);
+        }
+        if (nrec == 0) {
+            close(fd);
+            return 0;
+        }
+        void * p = mmap(nullptr, mapsize, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) {
+            fprintf(stderr, "Failed to map '%s'\n", fname);
+            return -1;
+        }
+        madvise(p, mapsize, MADV_SEQUENTIAL);
+        data = (const uint8_t *) p;
+    }
+
+    // the modular products reduce the full double-width result, so a record fits in Size = width as it is
+    const std::size_t need = fname ? params.width : (std::size_t) (params.nbits + 7)/8;
+
+    auto tStart = std::chrono::high_resolution_clock::now();
+
+    std::size_t ntotal = 0;
+    std::size_t nprime = 0;
+    if      (need <= 16)  ntotal = run<16> (data, nrec, params, nprime);
+    else if (need <= 32)  ntotal = run<32> (data, nrec, params, nprime);
+    else if (need <= 64)  ntotal = run<64> (data, nrec, params, nprime);
+    else if (need <= 128) ntotal = run<128>(data, nrec, params, nprime);
+    else                  ntotal = run<256>(data, nrec, params, nprime);
+
+    fflush(stdout);
+
+    auto tEnd = std::chrono::high_resolution_clock::now();
+
+    if (data) {
+        munmap((void *) data, mapsize);
+    }
+
+    {
+        auto t = std::chrono::duration_cast<std::chrono::milliseconds>(tEnd - tStart).count();
+        fprintf(stderr, "Checked %d numbers, %d primes, in %d ms: %g num/sec\n",
+                (int) ntotal, (int) nprime, (int) t, 1000.0*((double)(ntotal))/std::max(1, (int) t));
+    }
+
+    return 0;
+}
@@ -7,6 +7,87 @@
 
 #include "ggint.h"
 
+#include <array>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <csignal>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Miller-Rabin rounds for n - 1 = d*2^s
+// the squarings of each round stay in the internal form of the reduction context red
+template <std::size_t Size>
+struct MillerRabin {
+    using TNum = ggint::TNumTmpl<Size>;
+
+    const TNum & n;
+    const TNum & d;
+    std::size_t s;
+    std::size_t trials;
+    bool & result;
+
+    template <typename TRed>
+    void operator()(const TRed & red) const {
+        TNum _1; ggint::one(_1);
+        TNum n_1 = n; ggint::sub(_1, n_1);
+
+        typename TRed::TElem one, minus_one;
+        red.one(one);
+        red.to(n_1, minus_one);
+
+        result = true;
+        for (size_t i = 0; i < trials; ++i) {
+            TNum a;
+            {
+                TNum _max = n;
+                TNum _2; ggint::set(_2, 2);
+                TNum _4; ggint::set(_4, 4);
+                ggint::sub(_4, _max);
+
+                ggint::rand(a, _max);
+                ggint::add(_2, a);
+            }
+
+            TNum x;
+            ggint::pow_mod_ctx(red, a, d, x);
+
+            if (ggint::equal(x, _1) || ggint::equal(x, n_1)) {
+                continue;
+            }
+
+            typename TRed::TElem y;
+            red.to(x, y);
+
+            bool is_minus_one = false;
+            for (std::size_t r = 0; r < s - 1; ++r) {
+                red.sqr(y, y);
+
+                if (y == one) {
+                    result = false;
+                    return;
+                }
+
+                if (y == minus_one) {
+                    is_minus_one = true;
+                    break;
+                }
+            }
+
+            if (is_minus_one == false) {
+                result = false;
+                return;
+            }
+        }
+    }
+};
+
 // Miller-Robin primality test
 // return false: number n is composite
 // return true:  number n is very likely to be a prime
@@ -40,44 +121,570 @@ bool is_prime(const ggint::TNumTmpl<Size> & n, std::size_t trials = 0) {
         trials = 3;
     }
 
-    for (size_t i = 0; i < trials; ++i) {
-        TNum a;
-        {
-            TNum _max = n;
-            TNum _2; ggint::set(_2, 2);
-            TNum _4; ggint::set(_4, 4);
-            ggint::sub(_4, _max);
+    bool result = true;
+    ggint::with_reduction(n, MillerRabin<Size> { n, d, s, trials, result });
+
+    return result;
+}
 
-            ggint::rand(a, _max);
-            ggint::add(_2, a);
+// Base-2 Fermat test
+// return false: number n is composite
+// return true:  number n is a base-2 probable prime
+//
+template <std::size_t Size>
+bool is_prime_base2(const ggint::TNumTmpl<Size> & n) {
+    if (ggint::is_even(n)) return false;
+
+    using TNum = ggint::TNumTmpl<Size>;
+
+    TNum _1; ggint::one(_1);
+    TNum n_1 = n; ggint::sub(_1, n_1);
+
+    TNum x;
+    ggint::pow2_mod(n_1, n, x);
+
+    return ggint::equal(x, _1);
+}
+
+// Bulk primality test
+// res[i] = 1 if number n[i] is very likely to be a prime, 0 otherwise
+// Each number is first trial-divided by the smallPrimes, several of them per pass over the digits, and only the
+// survivors get the Miller-Rabin test. Numbers that fit in a size_t and are below the square of the largest small
+// prime are decided by the trial division alone.
+// The numbers are handed out to nthread threads in blocks of kBlock.
+//
+template <std::size_t Size>
+void is_prime_bulk(const ggint::TNumTmpl<Size> * n, std::size_t count, uint8_t * res,
+                   const std::vector<std::size_t> & smallPrimes, std::size_t trials = 0, int nthread = 1) {
+    constexpr std::size_t kBlock = 64;
+
+    // group the small primes so that the product of each group still allows r*kDigitMax + digit in a size_t
+    struct Group {
+        std::size_t prod;
+        std::size_t first;
+        std::size_t last;
+    };
+
+    std::vector<Group> groups;
+    for (std::size_t i = 0; i < smallPrimes.size(); ) {
+        Group g { 1, i, i };
+        while (g.last < smallPrimes.size() &&
+               g.prod <= (std::numeric_limits<std::size_t>::max()/ggint::kDigitMax)/smallPrimes[g.last]) {
+            g.prod *= smallPrimes[g.last++];
         }
+        groups.push_back(g);
+        i = g.last;
+    }
 
-        TNum x;
-        ggint::pow_mod(a, d, n, x);
+    auto test = [&](const ggint::TNumTmpl<Size> & x) -> uint8_t {
+        const auto xbits = ggint::nbits(x);
+        if (xbits <= 8*sizeof(std::size_t)) {
+            std::size_t v = 0;
+            for (std::size_t i = 0; i < sizeof(std::size_t) && i < Size; ++i) {
+                v |= ((std::size_t) x[i]) << (8*i);
+            }
+            if (v < 2) return 0;
+            if (v == 2) return 1;
+            for (auto p : smallPrimes) {
+                if (p*p > v) return 1;
+                if (v % p == 0) return 0;
+            }
+        }
+
+        for (const auto & g : groups) {
+            std::size_t r = 0;
+            ggint::mod(g.prod, x, r);
+            for (auto i = g.first; i < g.last; ++i) {
+                if (r % smallPrimes[i] == 0) return 0;
+            }
+        }
 
-        if (ggint::equal(x, _1) || ggint::equal(x, n_1)) {
-            continue;
+        return is_prime(x, trials) ? 1 : 0;
+    };
+
+    std::atomic<std::size_t> next(0);
+    auto worker = [&]() {
+        while (true) {
+            const std::size_t i0 = next.fetch_add(kBlock);
+            if (i0 >= count) break;
+            const std::size_t i1 = std::min(count, i0 + kBlock);
+            for (auto i = i0; i < i1; ++i) {
+                res[i] = test(n[i]);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < nthread; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto & w : workers) {
+        w.join();
+    }
+}
+
+// Bounded lock-free queue for any number of producers and consumers (D. Vyukov)
+// Each cell carries a sequence number that tells whether it is free for the push or full for the pop at the current
+// position, so push and pop only contend on their own position counter. The capacity is rounded up to a power of 2.
+// push/pop return false instead of blocking when the queue is full/empty
+//
+template <typename T>
+class TQueue {
+public:
+    explicit TQueue(std::size_t capacity) {
+        std::size_t n = 2;
+        while (n < capacity) n <<= 1;
+
+        mask = n - 1;
+        cells.reset(new Cell[n]);
+        for (std::size_t i = 0; i < n; ++i) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    bool push(const T & v) {
+        Cell * c = nullptr;
+        std::size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            c = &cells[pos & mask];
+            const std::size_t seq = c->seq.load(std::memory_order_acquire);
+            const intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+            if (dif == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
         }
+        c->data = v;
+        c->seq.store(pos + 1, std::memory_order_release);
 
-        for (std::size_t r = 0; r < s - 1; ++r) {
-            TNum x2, g;
-            ggint::mul(x, x, x2);
-            ggint::mod(n, x2, g);
-            x = g;
+        return true;
+    }
 
-            if (ggint::equal(x, _1)) {
+    bool pop(T & v) {
+        Cell * c = nullptr;
+        std::size_t pos = head.load(std::memory_order_relaxed);
+        while (true) {
+            c = &cells[pos & mask];
+            const std::size_t seq = c->seq.load(std::memory_order_acquire);
+            const intptr_t dif = (intptr_t) seq - (intptr_t) (pos + 1);
+            if (dif == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (dif < 0) {
                 return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
             }
+        }
+        v = c->data;
+        c->seq.store(pos + mask + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // approximate number of elements, for statistics
+    std::size_t size() const {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        return t > h ? std::min(t - h, capacity()) : 0;
+    }
 
-            if (ggint::equal(x, n_1)) {
-                break;
+    std::size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> seq;
+        T data;
+    };
+
+    std::size_t mask;
+    std::unique_ptr<Cell[]> cells;
+
+    alignas(64) std::atomic<std::size_t> head;
+    alignas(64) std::atomic<std::size_t> tail;
+};
+
+// Options of the long running searches
+//
+//   --shard i/N         search only the i-th of N disjoint parts of the search space
+//   --seed S            seed of the random generator, all shards of one search must use the same seed
+//   --checkpoint file   save the search state to file every --interval seconds and on SIGINT/SIGTERM
+//   --resume            continue from the state in the checkpoint file, if there is one
+//   --out file          write the result to file
+//
+struct SearchParams {
+    uint32_t shard = 0;
+    uint32_t nshard = 1;
+    uint64_t seed = 0;
+    bool hasSeed = false;
+
+    const char * checkpoint = nullptr;
+    bool resume = false;
+    int interval = 60;
+
+    const char * out = nullptr;
+};
+
+// exit codes of the searches, used by the coordinator
+enum SearchStatus {
+    kSearchFound       = 0,
+    kSearchExhausted   = 1,
+    kSearchInterrupted = 2,
+    kSearchError       = 3,
+};
+
+// parse the search options and remove them from argv
+// return the number of remaining arguments or -1 on error
+inline int parse_search_params(int argc, char ** argv, SearchParams & params) {
+    int n = 1;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--shard" && hasValue) {
+            unsigned a = 0, b = 0;
+            if (sscanf(argv[++i], "%u/%u", &a, &b) != 2 || b == 0 || a >= b) {
+                fprintf(stderr, "Invalid shard '%s', expected i/N with i < N\n", argv[i]);
+                return -1;
             }
+            params.shard = a;
+            params.nshard = b;
+        } else if (arg == "--seed" && hasValue) {
+            params.seed = strtoull(argv[++i], nullptr, 10);
+            params.hasSeed = true;
+        } else if (arg == "--checkpoint" && hasValue) {
+            params.checkpoint = argv[++i];
+        } else if (arg == "--interval" && hasValue) {
+            params.interval = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--resume") {
+            params.resume = true;
+        } else if (arg == "--out" && hasValue) {
+            params.out = argv[++i];
+        } else {
+            argv[n++] = argv[i];
+        }
+    }
+    argv[n] = nullptr;
+
+    return n;
+}
+
+// seed of the random generator of the current shard
+inline uint32_t shard_seed(const SearchParams & params) {
+    // splitmix64
+    uint64_t z = params.seed + 0x9e3779b97f4a7c15ull*(params.shard + 1);
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+    z = z ^ (z >> 31);
+
+    return (uint32_t) (z ^ (z >> 32));
+}
+
+// set when SIGINT or SIGTERM is received
+inline std::atomic<bool> & interrupted() {
+    static std::atomic<bool> flag(false);
+    return flag;
+}
+
+inline void catch_interrupts() {
+    auto handler = [](int) { interrupted() = true; };
+    signal(SIGINT, handler);
+    signal(SIGTERM, handler);
+}
+
+// Checkpoint file: header followed by the state of the search
+// The state is a plain struct of the search. The file is replaced atomically, so a crash while saving leaves the
+// previous checkpoint intact
+struct CheckpointHeader {
+    char     magic[4];
+    uint32_t version;
+    char     tool[16];
+    uint32_t shard;
+    uint32_t nshard;
+    uint64_t seed;
+    uint64_t size;
+    uint64_t checksum;
+};
+
+constexpr uint32_t kCheckpointVersion = 1;
+
+// FNV-1a
+inline uint64_t checksum(const void * data, std::size_t size) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (std::size_t i = 0; i < size; ++i) {
+        h ^= ((const uint8_t *) data)[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+inline CheckpointHeader checkpoint_header(const SearchParams & params, const char * tool, const void * state, std::size_t size) {
+    CheckpointHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, "ggck", 4);
+    hdr.version = kCheckpointVersion;
+    strncpy(hdr.tool, tool, sizeof(hdr.tool) - 1);
+    hdr.shard = params.shard;
+    hdr.nshard = params.nshard;
+    hdr.seed = params.seed;
+    hdr.size = size;
+    hdr.checksum = checksum(state, size);
+
+    return hdr;
+}
+
+template <typename TState>
+bool save_checkpoint(const SearchParams & params, const char * tool, const TState & state) {
+    if (params.checkpoint == nullptr) return true;
+
+    const auto hdr = checkpoint_header(params, tool, &state, sizeof(state));
+    const std::string tmp = std::string(params.checkpoint) + ".tmp";
+
+    FILE * f = fopen(tmp.c_str(), "wb");
+    if (f == nullptr) return false;
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 && fwrite(&state, sizeof(state), 1, f) == 1;
+    ok = (fclose(f) == 0) && ok;
+
+    return ok && rename(tmp.c_str(), params.checkpoint) == 0;
+}
+
+// return false if there is no checkpoint or it belongs to a different search
+// without --seed, the seed of the checkpoint is used
+template <typename TState>
+bool load_checkpoint(SearchParams & params, const char * tool, TState & state) {
+    if (params.checkpoint == nullptr) return false;
+
+    FILE * f = fopen(params.checkpoint, "rb");
+    if (f == nullptr) return false;
+
+    CheckpointHeader hdr;
+    TState tmp;
+    bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 && fread(&tmp, sizeof(tmp), 1, f) == 1;
+    fclose(f);
+
+    auto cur = params;
+    if (cur.hasSeed == false) {
+        cur.seed = hdr.seed;
+    }
+
+    const auto exp = checkpoint_header(cur, tool, &tmp, sizeof(tmp));
+    if (ok == false || memcmp(&hdr, &exp, sizeof(hdr)) != 0) {
+        fprintf(stderr, "Ignoring checkpoint '%s': corrupted or from a different search\n", params.checkpoint);
+        return false;
+    }
+
+    params.seed = cur.seed;
+    params.hasSeed = true;
+    state = tmp;
+
+    return true;
+}
+
+// write the result of the search to the --out file
+inline bool save_result(const SearchParams & params, const std::string & text) {
+    if (params.out == nullptr) return true;
+
+    FILE * f = fopen(params.out, "w");
+    if (f == nullptr) return false;
+    bool ok = fputs(text.c_str(), f) >= 0;
+
+    return (fclose(f) == 0) && ok;
+}
+
+// read the next line of f into line, return false at the end of the input
+// a line longer than the buffer is read to its end and returned truncated with complete = false, so each call
+// consumes exactly one input line
+template <std::size_t N>
+bool read_line(FILE * f, std::array<char, N> & line, bool & complete) {
+    if (fgets(line.data(), N, f) == nullptr) return false;
+
+    complete = true;
+    const std::size_t len = std::strlen(line.data());
+    if (len + 1 == N && line[len - 1] != '\n') {
+        int c;
+        while ((c = fgetc(f)) != EOF && c != '\n') {
+            complete = false;
         }
+    }
+
+    return true;
+}
+
+// Group of the dlp example: x < 2^kDlpExpBits is searched in g^x mod p with numbers of kDlpDigits digits
+const std::size_t kDlpDigits = 128; // max num : 2^(128*8) = 2^1024
+const std::size_t kDlpExpBits = 31;
+
+// Generator g - some big prime number. Currently the following number is hardcoded:
+// Decimal : 9456746831008455759418004378492269420473170215454266509970267803020225793040242784839755418466370610382516494614870926790804542382049298332204385846382671
+const ggint::TDigit kDlpGenerator[] {
+     79, 80,  59,  224,  23, 133, 197, 180,  74,  18, 243, 169, 197, 145, 177, 181,  46, 105, 194,  40,  34, 208, 209, 230,
+    110, 193, 227,  25, 123,  13,  19,  85,  38,  96,   8,  28,  10, 171, 252, 103,  85,  72, 192,  13, 164,  82, 137,  68,
+     83, 84,  213,  77,  30,  12, 255,  80,  34,  69, 177, 134, 154, 157, 143, 180,
+};
+
+// Prime p - some big prime number. Currently the following number is hardcoded:
+// Decimal : 12378906059519127458310609554398266922939100031765205007867339459855295869629445866487073269538954194095797384746272202142613890509010176538034231237940969
+const ggint::TDigit kDlpPrime[] {
+    233,  22, 240,  17, 213,  44,  78, 203, 210, 166, 183, 116, 151, 247, 203, 227, 116,  27, 133, 243, 187, 249,  41, 250,
+    131, 142, 131, 172,  68,  89, 228,  59, 213, 120, 234,   6, 137,  32, 187,  24, 208, 245, 240,  17,   7,  15,  56, 112,
+    227,  17, 140,  81,   8, 188, 254, 206, 183, 163,  49,  97,  25, 213,  90, 236,
+};
 
-        if (ggint::equal(x, n_1) == false) {
+// Precomputation cache: header, table of sections and the data of the sections
+// The file is written by gen_cache and mapped read-only. The data of each section starts at a multiple of kCacheAlign
+// bytes. The loaders below copy the sections into the tables of the examples, so the cache only saves their
+// recomputation at startup, not their memory. gen_cache replaces the file atomically, so a running process keeps its
+// old mapping
+struct CacheHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t nsection;
+    uint32_t reserved;
+    uint64_t size;      // of the whole file
+    uint64_t checksum;  // of everything after the header
+};
+
+struct CacheSection {
+    char     name[24];
+    uint64_t offset;
+    uint64_t size;
+};
+
+constexpr uint32_t kCacheVersion = 1;
+constexpr std::size_t kCacheAlign = 64;
+
+// the cache file is given by the GGINT_CACHE environment variable, by default "ggint.cache" in the working directory
+inline const char * cache_path() {
+    const char * path = getenv("GGINT_CACHE");
+    return path ? path : "ggint.cache";
+}
+
+class TCache {
+public:
+    TCache() = default;
+    TCache(const TCache &) = delete;
+    TCache & operator=(const TCache &) = delete;
+
+    ~TCache() {
+        if (data) munmap(data, size);
+    }
+
+    // return false if there is no cache file or it is corrupted or from a different version
+    bool open(const char * fname) {
+        const int fd = ::open(fname, O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        void * p = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && (std::size_t) st.st_size >= sizeof(CacheHeader)) {
+            p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (p == MAP_FAILED) return false;
+
+        const auto & hdr = *(const CacheHeader *) p;
+        const std::size_t n = st.st_size;
+        bool ok = memcmp(hdr.magic, "ggpc", 4) == 0 && hdr.version == kCacheVersion && hdr.size == n &&
+            sizeof(CacheHeader) + hdr.nsection*sizeof(CacheSection) <= n;
+        ok = ok && hdr.checksum == checksum((const uint8_t *) p + sizeof(CacheHeader), n - sizeof(CacheHeader));
+
+        const auto * sec = (const CacheSection *) ((const uint8_t *) p + sizeof(CacheHeader));
+        for (uint32_t i = 0; ok && i < hdr.nsection; ++i) {
+            ok = sec[i].offset % kCacheAlign == 0 && sec[i].offset <= n && sec[i].size <= n - sec[i].offset;
+        }
+
+        if (ok == false) {
+            fprintf(stderr, "Ignoring cache '%s': corrupted or from a different version\n", fname);
+            munmap(p, n);
             return false;
         }
+
+        if (data) munmap(data, size);
+        data = p;
+        size = n;
+
+        return true;
+    }
+
+    // data of the section or nullptr if there is no such section
+    const void * section(const char * name, std::size_t & n) const {
+        if (data == nullptr) return nullptr;
+
+        const auto & hdr = *(const CacheHeader *) data;
+        const auto * sec = (const CacheSection *) ((const uint8_t *) data + sizeof(CacheHeader));
+        for (uint32_t i = 0; i < hdr.nsection; ++i) {
+            if (strncmp(sec[i].name, name, sizeof(sec[i].name)) == 0) {
+                n = sec[i].size;
+                return (const uint8_t *) data + sec[i].offset;
+            }
+        }
+
+        return nullptr;
     }
 
+private:
+    void * data = nullptr;
+    std::size_t size = 0;
+};
+
+// section "primes": uint32_t limit followed by all primes below limit
+// primes = all primes below n, return false if the cache does not have them
+inline bool load_small_primes(const TCache & cache, std::size_t n, std::vector<std::size_t> & primes) {
+    std::size_t size = 0;
+    const uint32_t * p = (const uint32_t *) cache.section("primes", size);
+    if (p == nullptr || size < sizeof(uint32_t) || p[0] < n) return false;
+
+    const uint32_t * begin = p + 1;
+    const uint32_t * end = std::lower_bound(begin, p + size/sizeof(uint32_t), n);
+    primes.assign(begin, end);
+
+    return primes.empty() == false;
+}
+
+// table[i] = g^(2^i) mod p, i < nbits
+template <std::size_t Size>
+void fixed_base_table(const ggint::TNumTmpl<Size> & g, const ggint::TNumTmpl<Size> & p, std::size_t nbits,
+                      std::vector<ggint::TNumTmpl<Size>> & table) {
+    table.resize(nbits);
+    for (std::size_t i = 0; i < nbits; ++i) {
+        if (i == 0) {
+            ggint::mod(p, g, table[0]);
+        } else {
+            ggint::sqr_mod(table[i - 1], p, table[i]);
+        }
+    }
+}
+
+// r = g^x mod p with the table of fixed_base_table, x < 2^table.size()
+template <std::size_t Size>
+void fixed_base_pow(const std::vector<ggint::TNumTmpl<Size>> & table, const ggint::TNumTmpl<Size> & p, uint64_t x,
+                    ggint::TNumTmpl<Size> & r) {
+    ggint::one(r);
+    for (std::size_t i = 0; i < table.size() && (x >> i) != 0; ++i) {
+        if ((x >> i) & 1) {
+            ggint::mul_mod(r, table[i], p, r);
+        }
+    }
+}
+
+// section of fixed-base powers: g, p and table[i] = g^(2^i) mod p, as numbers of Size digits
+// table = the powers from the cache, return false if the cache does not have them for this g and p
+template <std::size_t Size>
+bool load_fixed_base(const TCache & cache, const char * name, const ggint::TNumTmpl<Size> & g,
+                     const ggint::TNumTmpl<Size> & p, std::size_t nbits, std::vector<ggint::TNumTmpl<Size>> & table) {
+    using TNum = ggint::TNumTmpl<Size>;
+    static_assert(sizeof(TNum) == Size, "TNumTmpl is expected to be a plain array of digits");
+
+    std::size_t size = 0;
+    const TNum * t = (const TNum *) cache.section(name, size);
+    if (t == nullptr || size < (nbits + 2)*Size) return false;
+    if (ggint::equal(t[0], g) == false || ggint::equal(t[1], p) == false) return false;
+
+    table.assign(t + 2, t + 2 + nbits);
+
     return true;
 }
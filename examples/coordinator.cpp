@@ -0,0 +1,192 @@
+/*! \file coordinator.cpp
+ *  \brief Run a search as N worker processes, one shard each, and merge their results
+ *  \author Georgi Gerganov
+ *
+ *  Each worker gets --shard i/N, the common --seed and its own checkpoint, output and log files in the work
+ *  directory. Workers that are interrupted or die are restarted from their checkpoint. Running the coordinator
+ *  again with the same directory resumes the whole search.
+ *
+ *  Example:
+ *
+ *      ./coordinator 4 work-dlp ./dlp 1
+ *      ./coordinator 8 work-sp ./find_safe_prime 512
+ *
+ */
+
+#include "common.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// restarts of a shard before giving up on it
+const int kMaxRestarts = 5;
+
+struct Worker {
+    pid_t pid = -1;
+    int restarts = 0;
+    bool done = false;
+};
+
+std::string shard_file(const std::string & dir, int i, const char * ext) {
+    return dir + "/shard-" + std::to_string(i) + "." + ext;
+}
+
+bool read_file(const std::string & fname, std::string & text) {
+    FILE * f = fopen(fname.c_str(), "r");
+    if (f == nullptr) return false;
+
+    text.clear();
+    std::array<char, 1024> buf;
+    std::size_t n = 0;
+    while ((n = fread(buf.data(), 1, buf.size(), f)) > 0) {
+        text.append(buf.data(), n);
+    }
+    fclose(f);
+
+    return true;
+}
+
+// the seed is stored in the work directory, so that a restarted search continues with the same one
+uint64_t load_or_create_seed(const std::string & dir) {
+    const std::string fname = dir + "/seed";
+
+    std::string text;
+    if (read_file(fname, text)) {
+        return strtoull(text.c_str(), nullptr, 10);
+    }
+
+    const uint64_t seed = std::chrono::high_resolution_clock::now().time_since_epoch().count() & 0xffffffffu;
+    FILE * f = fopen(fname.c_str(), "w");
+    if (f) {
+        fprintf(f, "%llu\n", (unsigned long long) seed);
+        fclose(f);
+    }
+
+    return seed;
+}
+
+pid_t spawn(const std::vector<std::string> & cmd, int i, int n, uint64_t seed, const std::string & dir) {
+    std::vector<std::string> args = cmd;
+    args.push_back("--shard");      args.push_back(std::to_string(i) + "/" + std::to_string(n));
+    args.push_back("--seed");       args.push_back(std::to_string((unsigned long long) seed));
+    args.push_back("--checkpoint"); args.push_back(shard_file(dir, i, "ckpt"));
+    args.push_back("--resume");
+    args.push_back("--out");        args.push_back(shard_file(dir, i, "out"));
+
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    if (freopen(shard_file(dir, i, "log").c_str(), "a", stdout) == nullptr) {
+        _exit(kSearchError);
+    }
+
+    std::vector<char *> argv;
+    for (auto & a : args) argv.push_back(&a[0]);
+    argv.push_back(nullptr);
+
+    execv(argv[0], argv.data());
+    _exit(kSearchError);
+}
+
+int main(int argc, char ** argv) {
+    printf("Usage: %s nworker dir command [args ...]\n", argv[0]);
+    if (argc < 4) return kSearchError;
+
+    const int nworker = std::max(1, atoi(argv[1]));
+    const std::string dir = argv[2];
+    const std::vector<std::string> cmd(argv + 3, argv + argc);
+
+    mkdir(dir.c_str(), 0755);
+
+    const uint64_t seed = load_or_create_seed(dir);
+    printf("Running '%s' as %d shards, seed = %llu, work dir = '%s'\n",
+           cmd[0].c_str(), nworker, (unsigned long long) seed, dir.c_str());
+
+    catch_interrupts();
+
+    std::vector<Worker> workers(nworker);
+    for (int i = 0; i < nworker; ++i) {
+        std::string text;
+        if (read_file(shard_file(dir, i, "out"), text)) {
+            printf("Shard %d: %s", i, text.c_str());
+            return kSearchFound;
+        }
+    }
+
+    for (int i = 0; i < nworker; ++i) {
+        workers[i].pid = spawn(cmd, i, nworker, seed, dir);
+    }
+
+    int status = kSearchExhausted;
+    int nrunning = nworker;
+    while (nrunning > 0) {
+        if (interrupted() && status != kSearchInterrupted) {
+            printf("Interrupted, stopping the workers\n");
+            status = kSearchInterrupted;
+            for (auto & w : workers) {
+                if (w.pid > 0) kill(w.pid, SIGTERM);
+            }
+        }
+
+        int ws = 0;
+        pid_t pid = waitpid(-1, &ws, WNOHANG);
+        if (pid <= 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+
+        int i = 0;
+        while (i < nworker && workers[i].pid != pid) ++i;
+        if (i == nworker) continue;
+
+        auto & w = workers[i];
+        w.pid = -1;
+        --nrunning;
+
+        const int code = WIFEXITED(ws) ? WEXITSTATUS(ws) : -1;
+        if (code == kSearchFound) {
+            printf("Shard %d found a result\n", i);
+            w.done = true;
+            if (status != kSearchFound && status != kSearchInterrupted) {
+                status = kSearchFound;
+                for (auto & other : workers) {
+                    if (other.pid > 0) kill(other.pid, SIGTERM);
+                }
+            }
+        } else if (code == kSearchExhausted) {
+            printf("Shard %d is exhausted\n", i);
+            w.done = true;
+        } else if (status == kSearchExhausted && w.restarts < kMaxRestarts) {
+            ++w.restarts;
+            printf("Shard %d stopped (%s %d), restarting from its checkpoint\n", i,
+                   WIFEXITED(ws) ? "exit code" : "signal", WIFEXITED(ws) ? code : WTERMSIG(ws));
+            w.pid = spawn(cmd, i, nworker, seed, dir);
+            ++nrunning;
+        } else if (status == kSearchExhausted) {
+            printf("Shard %d failed %d times, giving up on it\n", i, w.restarts + 1);
+            status = kSearchError;
+        }
+    }
+
+    // merge the results of all shards
+    int nfound = 0;
+    for (int i = 0; i < nworker; ++i) {
+        std::string text;
+        if (read_file(shard_file(dir, i, "out"), text)) {
+            printf("Shard %d: %s", i, text.c_str());
+            ++nfound;
+        }
+    }
+
+    if (nfound > 0) return kSearchFound;
+
+    printf("No result\n");
+    return status;
+}
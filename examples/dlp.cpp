@@ -4,14 +4,24 @@
  */
 
 #include "ggint.h"
+#include "common.h"
 
 #include <thread>
+#include <chrono>
 
-const std::size_t kDigits = 128; // max num : 2^(128*8) = 2^1024
-using TNum = ggint::TNumTmpl<kDigits>;
+using TNum = ggint::TNumTmpl<kDlpDigits>;
+
+// checkpoint: all exponents of the shard below x have been tested
+struct State {
+    uint64_t x;
+};
 
 int main(int argc, char ** argv) {
-    printf("Usage: %s [nthread]\n", argv[0]);
+    SearchParams params;
+    argc = parse_search_params(argc, argv, params);
+
+    printf("Usage: %s [nthread] [--shard i/N] [--seed S] [--checkpoint file [--resume]] [--out file]\n", argv[0]);
+    if (argc < 0) return kSearchError;
 
     int nthread = std::thread::hardware_concurrency();
     if (argc > 1) {
@@ -23,74 +33,72 @@ int main(int argc, char ** argv) {
 
     printf("Using %d threads\n", nthread);
 
-    // uncomment to randomize
-    srand(time(0));
+    // exponents tested by this shard: [xlo, xhi)
+    const uint64_t xmax = 1ull << kDlpExpBits;
+    const uint64_t xlo = 1 + (xmax - 1)*params.shard/params.nshard;
+    const uint64_t xhi = 1 + (xmax - 1)*(params.shard + 1)/params.nshard;
 
-    // Generator g - some big prime number. Currently the following number is hardcoded:
-    // Decimal : 9456746831008455759418004378492269420473170215454266509970267803020225793040242784839755418466370610382516494614870926790804542382049298332204385846382671
-    std::vector<ggint::TDigit> gbytes {
-         79, 80,  59,  224,  23, 133, 197, 180,  74,  18, 243, 169, 197, 145, 177, 181,  46, 105, 194,  40,  34, 208, 209, 230,
-        110, 193, 227,  25, 123,  13,  19,  85,  38,  96,   8,  28,  10, 171, 252, 103,  85,  72, 192,  13, 164,  82, 137,  68,
-         83, 84,  213,  77,  30,  12, 255,  80,  34,  69, 177, 134, 154, 157, 143, 180,
-    };
+    State state { xlo };
+    if (params.resume && load_checkpoint(params, "dlp", state)) {
+        printf("Resuming from x = %d\n", (int) state.x);
+    }
 
-    // Prime p - some big prime number. Currently the following number is hardcoded:
-    // Decimal : 12378906059519127458310609554398266922939100031765205007867339459855295869629445866487073269538954194095797384746272202142613890509010176538034231237940969
-    std::vector<ggint::TDigit> pbytes {
-        233,  22, 240,  17, 213,  44,  78, 203, 210, 166, 183, 116, 151, 247, 203, 227, 116,  27, 133, 243, 187, 249,  41, 250,
-        131, 142, 131, 172,  68,  89, 228,  59, 213, 120, 234,   6, 137,  32, 187,  24, 208, 245, 240,  17,   7,  15,  56, 112,
-        227,  17, 140,  81,   8, 188, 254, 206, 183, 163,  49,  97,  25, 213,  90, 236,
-    };
+    // all shards of a search have to generate the same problem, so they share the seed
+    if (params.hasSeed == false) {
+        params.seed = time(0);
+    }
+    srand(params.seed);
 
     TNum g, p, q;
 
     ggint::zero(g);
-    for (int i = 0; i < (int) gbytes.size(); ++i) g[i] = gbytes[i];
+    std::copy(std::begin(kDlpGenerator), std::end(kDlpGenerator), g.begin());
     ggint::print("g", g, false);
 
     ggint::zero(p);
-    for (int i = 0; i < (int) pbytes.size(); ++i) p[i] = pbytes[i];
+    std::copy(std::begin(kDlpPrime), std::end(kDlpPrime), p.begin());
     ggint::print("p", p, false);
 
+    // gpow[i] = g^(2^i) mod p, from the cache if it has them
+    std::vector<TNum> gpow;
+    {
+        TCache cache;
+        if (cache.open(cache_path()) && load_fixed_base(cache, "dlp", g, p, kDlpExpBits, gpow)) {
+            printf("Powers of g loaded from '%s'\n", cache_path());
+        } else {
+            fixed_base_table(g, p, kDlpExpBits, gpow);
+        }
+    }
+
     // generate x randomly and pretend we don't know it.
     // we want to find it
-    uint64_t xmax = 1 << 31;
     uint64_t xtrue = rand()%xmax;
 
     // Number q - in real world, this number is given (i.e. we observe it during the target communication).
     // Here we generate it using the true x from above
-    {
-        TNum x;
-        ggint::set(x, xtrue);
-        ggint::pow_mod(g, x, p, q);
-        ggint::print("q", q, false);
-    }
+    fixed_base_pow(gpow, p, xtrue, q);
+    ggint::print("q", q, false);
 
     // precompute gn = g^n mod p, n - nthreads
-    TNum gn = g;
-    for (int i = 1; i < nthread; ++i) {
-        TNum t;
-        ggint::mul(gn, g, t);
-        ggint::mod(p, t, gn);
-    }
+    TNum gn;
+    fixed_base_pow(gpow, p, nthread, gn);
     ggint::print("g^nthread", gn, false);
 
-    TNum gcur;
-    ggint::set(gcur, 1);
-
     printf("\n");
     printf("True x = %d\n", (int) xtrue);
+    printf("Shard %d/%d: x in [%d, %d)\n", (int) params.shard, (int) params.nshard, (int) xlo, (int) xhi);
     printf("Searching ... please wait\n");
 
-    bool found = false;
+    catch_interrupts();
+
+    std::atomic<bool> found(false);
+    std::atomic<uint64_t> xfound(0);
+    std::atomic<int> ndone(0);
+    std::vector<std::atomic<uint64_t>> progress(nthread);
     std::vector<std::thread> worker(nthread);
     for (int i = 0; i < nthread; ++i) {
-        TNum t;
-        ggint::mul(gcur, g, t);
-        ggint::mod(p, t, gcur);
-
         // The core search:
-        // The i-th worker tests: g^i, g^(i+n), g^(i+2n), g^(i + 3n), ...
+        // The i-th worker tests: g^(x0+i), g^(x0+i+n), g^(x0+i+2n), g^(x0+i+3n), ...
         // n is the number of threads
         // We use the equality:
         //
@@ -98,9 +106,14 @@ int main(int argc, char ** argv) {
         //
         // The number gn = (g^n mod p) is precomputed
         //
-        worker[i] = std::thread([&, i, gcur]() mutable {
-            uint64_t x = i + 1;
-            while (x < xmax) {
+        progress[i] = state.x + i;
+        worker[i] = std::thread([&, i]() {
+            uint64_t x = state.x + i;
+
+            TNum gcur;
+            fixed_base_pow(gpow, p, x, gcur);
+
+            while (x < xhi) {
                 if (ggint::equal(gcur, q)) {
                     printf("\n");
                     printf("Found x = %d\n", (int) x);
@@ -109,15 +122,15 @@ int main(int argc, char ** argv) {
                     } else {
                         printf("Failure! Found x and True x do not match\n");
                     }
+                    xfound = x;
                     found = true;
                 }
-                if (found) break;
+                if (found || interrupted()) break;
 
-                TNum t;
-                ggint::mul(gcur, gn, t);
-                ggint::mod(p, t, gcur);
+                ggint::mul_mod(gcur, gn, p, gcur);
 
                 x += nthread;
+                progress[i] = x;
 
                 // progress
                 if (i == 0 && x % 1000 < nthread) {
@@ -129,11 +142,47 @@ int main(int argc, char ** argv) {
                     fflush(stdout);
                 }
             }
+
+            ++ndone;
         });
     }
+
+    // all exponents below the smallest one in progress have been tested
+    auto update_state = [&]() {
+        state.x = xhi;
+        for (int i = 0; i < nthread; ++i) {
+            state.x = std::min<uint64_t>(state.x, progress[i]);
+        }
+    };
+
+    auto tLast = std::chrono::steady_clock::now();
+    while (ndone < nthread) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto tCur = std::chrono::steady_clock::now();
+        if (std::chrono::duration_cast<std::chrono::seconds>(tCur - tLast).count() >= params.interval) {
+            update_state();
+            save_checkpoint(params, "dlp", state);
+            tLast = tCur;
+        }
+    }
+
     for (int i = 0; i < nthread; ++i) {
         worker[i].join();
     }
 
-    return 0;
+    if (found) {
+        save_result(params, "x = " + std::to_string((unsigned long long) xfound) + "\n");
+        return kSearchFound;
+    }
+
+    update_state();
+    save_checkpoint(params, "dlp", state);
+
+    if (interrupted()) {
+        printf("\nInterrupted at x = %d\n", (int) state.x);
+        return kSearchInterrupted;
+    }
+
+    printf("\nNo x in [%d, %d)\n", (int) xlo, (int) xhi);
+    return kSearchExhausted;
 }
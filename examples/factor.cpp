@@ -0,0 +1,111 @@
+/*! \file factor.cpp
+ *  \brief Factor numbers with trial division, Pollard rho and ECM
+ *  \author Georgi Gerganov
+ *
+ *  The numbers are given on the command line or one per line on stdin, decimal or hexadecimal with "0x" prefix.
+ *  Factors that are not found with ECM up to the given number of digits are printed as composite cofactors.
+ *
+ *  Example:
+ *
+ *      ./factor 4 30 1000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001
+ *      ./find_dsa_prime 1024 160 | ... | ./factor 4 25
+ *
+ */
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "ggint.h"
+#include "common.h"
+#include "factor.h"
+
+const std::size_t kDigits = 512; // max num : 2^(512*8) = 2^4096
+using TNum = ggint::TNumTmpl<kDigits>;
+
+// numbers up to 2048 bits, so that the products of the reduction contexts fit
+const std::size_t kMaxBits = 2048;
+
+// sieve
+std::vector<std::size_t> smallPrimes;
+
+void add_prime(std::size_t n) {
+    for (auto p : smallPrimes) {
+        if (p*p > n) break;
+        if (n%p == 0) return;
+    }
+    smallPrimes.push_back(n);
+}
+
+void calc_small_primes(std::size_t n) {
+    smallPrimes.clear();
+    smallPrimes.push_back(2);
+    for (auto k = 3; k < n; ++k) {
+        add_prime(k);
+    }
+}
+
+void run(const char * str, const FactorParams & params) {
+    TNum n;
+    if (ggint::parse(str, n) == false || ggint::nbits(n) > kMaxBits) {
+        printf("Invalid number '%s', expected at most %d bits\n", str, (int) kMaxBits);
+        return;
+    }
+
+    const auto tStart = std::chrono::steady_clock::now();
+
+    std::vector<TNum> primes, composites;
+    factor(n, smallPrimes, params, primes, composites);
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+    std::string res = ggint::to_string(n) + " =";
+    for (std::size_t i = 0; i < primes.size(); ++i) {
+        res += (i == 0 ? " " : " * ") + ggint::to_string(primes[i]);
+    }
+    for (const auto & c : composites) {
+        res += (res.back() == '=' ? " " : " * ") + std::string("C(") + ggint::to_string(c) + ")";
+    }
+    printf("%s\n", res.c_str());
+    printf("  %d digits, %.2f s\n", (int) ggint::to_string(n).size(), elapsed);
+    fflush(stdout);
+}
+
+int main(int argc, char ** argv) {
+    printf("Usage: %s nthread maxdigits [n ...]\n", argv[0]);
+    if (argc < 3) return -1;
+
+    FactorParams params;
+    params.nthread = std::max(1, atoi(argv[1]));
+    params.maxDigits = std::max(15, atoi(argv[2]));
+    params.seed = time(0);
+    params.verbose = getenv("GGINT_VERBOSE") != nullptr;
+
+    // trial division up to 2^16
+    const std::size_t nsieve = 1 << 16;
+    TCache cache;
+    if (cache.open(cache_path()) == false || load_small_primes(cache, nsieve, smallPrimes) == false) {
+        calc_small_primes(nsieve);
+    }
+
+    if (argc > 3) {
+        for (int i = 3; i < argc; ++i) {
+            run(argv[i], params);
+        }
+        return 0;
+    }
+
+    std::array<char, 4096> line;
+    bool complete = true;
+    while (read_line(stdin, line, complete)) {
+        if (line[0] == '\n') continue;
+        if (complete == false) {
+            printf("Invalid number, line longer than %zu characters\n", line.size() - 1);
+            continue;
+        }
+        run(line.data(), params);
+    }
+
+    return 0;
+}
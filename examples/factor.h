@@ -0,0 +1,473 @@
+/*! \file factor.h
+ *  \brief Pollard rho (Brent) and ECM with Montgomery curves
+ *  \author Georgi Gerganov
+ *
+ *  Both methods work in the internal form of the reduction context that pow_mod would use for n, so the products
+ *  are Montgomery (or special form) multiplications. A factor f of n shows up as gcd(x, n) for some x in the
+ *  internal form, since the conversion only multiplies x by a number coprime to n.
+ */
+
+#pragma once
+
+#include "ggint.h"
+#include "common.h"
+
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// steps of rho between two gcds
+const uint64_t kRhoBatch = 128;
+
+// Brent's variant of Pollard's rho for x -> x^2 + c
+// y runs ahead of the saved x by r = 1, 2, 4, ... steps. The differences x - y are multiplied together and only every
+// kRhoBatch steps go through a gcd with n. When a batch collects all factors of n, it is replayed one step at a time
+template <std::size_t Size>
+struct Rho {
+    using TNum = ggint::TNumTmpl<Size>;
+
+    const TNum & n;
+    uint64_t c;
+    uint64_t maxIter;
+    const std::atomic<bool> & stop;
+    TNum & f;
+    bool & found;
+
+    template <typename TRed>
+    void operator()(const TRed & red) const {
+        using TElem = typename TRed::TElem;
+
+        TNum t;
+        TElem x, y, ys, q, d, cc;
+        ggint::set(t, c);
+        red.to(t, cc);
+        red.add(cc, cc, y);
+        red.one(q);
+
+        auto step = [&](TElem & z) {
+            red.sqr(z, z);
+            red.add(z, cc, z);
+        };
+
+        // f = gcd(z, n)
+        auto gcd = [&](const TElem & z) {
+            red.from(z, t);
+            ggint::gcd(t, n, f);
+            return ggint::equal(f, n) == false && (f[0] != 1 || ggint::ndigits(f) != 1);
+        };
+
+        found = false;
+        uint64_t niter = 0;
+        for (uint64_t r = 1; niter < maxIter && stop == false; r *= 2) {
+            x = y;
+            for (uint64_t i = 0; i < r; ++i) step(y);
+            niter += r;
+
+            for (uint64_t k = 0; k < r && niter < maxIter; k += kRhoBatch) {
+                ys = y;
+                const uint64_t m = std::min(kRhoBatch, r - k);
+                for (uint64_t i = 0; i < m; ++i) {
+                    step(y);
+                    red.sub(x, y, d);
+                    red.mul(q, d, q);
+                }
+                niter += m;
+
+                if (gcd(q)) {
+                    found = true;
+                    return;
+                }
+
+                // the product is 0 mod n: replay the batch
+                if (ggint::equal(f, n)) {
+                    for (uint64_t i = 0; i < m; ++i) {
+                        step(ys);
+                        red.sub(x, ys, d);
+                        if (gcd(d)) {
+                            found = true;
+                            return;
+                        }
+                    }
+                    return;
+                }
+            }
+        }
+    }
+};
+
+// Bounds of one ECM run: stage 1 multiplies the point by all prime powers up to B1, stage 2 looks for one more prime
+// factor of the order in (B1, B2]
+struct EcmPlan {
+    uint64_t B1 = 0;
+    uint64_t B2 = 0;
+
+    std::vector<uint64_t> powers;  // the largest power of each prime <= B1, that is <= B1
+    std::vector<bool> isPrime;     // up to B2 + kEcmD
+
+    static constexpr uint64_t kEcmD = 210;
+
+    void init(uint64_t b1, uint64_t b2) {
+        B1 = b1;
+        B2 = std::max(b1, b2);
+
+        isPrime.assign(B2 + kEcmD + 1, true);
+        isPrime[0] = isPrime[1] = false;
+        for (uint64_t i = 2; i*i <= B2 + kEcmD; ++i) {
+            if (isPrime[i] == false) continue;
+            for (uint64_t j = i*i; j <= B2 + kEcmD; j += i) isPrime[j] = false;
+        }
+
+        powers.clear();
+        for (uint64_t p = 2; p <= B1; ++p) {
+            if (isPrime[p] == false) continue;
+            uint64_t q = p;
+            while (q <= B1/p) q *= p;
+            powers.push_back(q);
+        }
+    }
+};
+
+// One ECM curve By^2 = x^3 + Ax^2 + x with Suyama's parametrization, which gives a group order divisible by 12
+// The points are (X : Z) without y. The curve constant enters only as a24 = (A + 2)/4, kept as the fraction
+// a24n/a24d so that no modular inverse is needed
+template <std::size_t Size>
+struct EcmCurve {
+    using TNum = ggint::TNumTmpl<Size>;
+
+    const TNum & n;
+    uint64_t sigma;
+    const EcmPlan & plan;
+    const std::atomic<bool> & stop;
+    TNum & f;
+    bool & found;
+
+    template <typename TRed>
+    void operator()(const TRed & red) const {
+        using TElem = typename TRed::TElem;
+
+        struct Point {
+            TElem x;
+            TElem z;
+        };
+
+        TElem a24n, a24d;
+
+        // r = 2p
+        auto dbl = [&](const Point & p, Point & r) {
+            TElem s, d, t;
+            red.add(p.x, p.z, s);
+            red.sqr(s, s);
+            red.sub(p.x, p.z, d);
+            red.sqr(d, d);
+            red.sub(s, d, t);       // 4xz
+            red.mul(d, a24d, d);
+            red.mul(s, d, r.x);
+            red.mul(t, a24n, s);
+            red.add(s, d, s);
+            red.mul(t, s, r.z);
+        };
+
+        // r = p + q, with pq = p - q. r can be p or q
+        auto add = [&](const Point & p, const Point & q, const Point & pq, Point & r) {
+            TElem u, v, s, t;
+            red.sub(p.x, p.z, u);
+            red.add(q.x, q.z, t);
+            red.mul(u, t, u);
+            red.add(p.x, p.z, v);
+            red.sub(q.x, q.z, t);
+            red.mul(v, t, v);
+            red.add(u, v, s);
+            red.sqr(s, s);
+            red.sub(u, v, t);
+            red.sqr(t, t);
+            red.mul(pq.z, s, r.x);
+            red.mul(pq.x, t, r.z);
+        };
+
+        // r = k*p, Montgomery ladder: r1 - r0 = p
+        auto mul = [&](uint64_t k, const Point & p, Point & r) {
+            if (k == 1) {
+                r = p;
+                return;
+            }
+            Point r0 = p, r1;
+            dbl(p, r1);
+            int i = 62;
+            while (((k >> (i + 1)) & 1) == 0) --i;
+            for (; i >= 0; --i) {
+                if ((k >> i) & 1) {
+                    add(r1, r0, p, r0);
+                    dbl(r1, r1);
+                } else {
+                    add(r1, r0, p, r1);
+                    dbl(r0, r0);
+                }
+            }
+            r = r0;
+        };
+
+        // f = gcd(z, n)
+        auto gcd = [&](const TElem & z) {
+            TNum t;
+            red.from(z, t);
+            ggint::gcd(t, n, f);
+            return ggint::equal(f, n) == false && (f[0] != 1 || ggint::ndigits(f) != 1);
+        };
+
+        // Suyama: u = sigma^2 - 5, v = 4 sigma, x0 = u^3, z0 = v^3, a24 = (v - u)^3 (3u + v) / (16 u^3 v)
+        Point p;
+        {
+            TNum t;
+            TElem s, u, v, w;
+            ggint::set(t, sigma);
+            red.to(t, s);
+            ggint::set(t, 5);
+            red.to(t, w);
+            red.sqr(s, u);
+            red.sub(u, w, u);
+            red.add(s, s, v);
+            red.dbl(v);
+
+            red.sqr(u, w);
+            red.mul(w, u, p.x);
+            red.sqr(v, w);
+            red.mul(w, v, p.z);
+
+            red.sub(v, u, w);
+            red.sqr(w, a24n);
+            red.mul(a24n, w, a24n);
+            red.add(u, u, w);
+            red.add(w, u, w);
+            red.add(w, v, w);
+            red.mul(a24n, w, a24n);
+
+            red.mul(p.x, v, a24d);
+            red.dbl(a24d);
+            red.dbl(a24d);
+            red.dbl(a24d);
+            red.dbl(a24d);
+        }
+
+        found = false;
+
+        // stage 1
+        for (std::size_t i = 0; i < plan.powers.size(); ++i) {
+            mul(plan.powers[i], p, p);
+            if (i % 1024 == 0 && stop) return;
+        }
+        if (gcd(p.z)) {
+            found = true;
+            return;
+        }
+
+        // stage 2: R = m*D*p runs through (B1, B2], for each prime m*D +- j the product collects
+        // x(R)*z(jp) - x(jp)*z(R), which is 0 mod f when (m*D -+ j)*p = 0 mod f
+        const uint64_t D = EcmPlan::kEcmD;
+        std::vector<Point> jp(D/2);  // jp[j] = j*p for odd j
+        Point p2;
+        dbl(p, p2);
+        jp[1] = p;
+        add(p2, p, p, jp[3]);
+        for (uint64_t j = 5; j < D/2; j += 2) {
+            add(jp[j - 2], p2, jp[j - 4], jp[j]);
+        }
+
+        Point pD, r0, r1, t;
+        add(jp[D/2 - 2], p2, jp[D/2 - 4], t);  // (D/2)p, D/2 is odd
+        dbl(t, pD);
+
+        uint64_t m = plan.B1/D;
+        mul(std::max<uint64_t>(1, m)*D, p, r0);
+        mul(std::max<uint64_t>(1, m)*D + D, p, r1);
+        if (m == 0) m = 1;
+
+        TElem acc, u, v;
+        red.one(acc);
+        for (; m*D < plan.B2 + D; ++m) {
+            for (uint64_t j = 1; j < D/2; j += 2) {
+                const uint64_t lo = m*D - j;
+                const uint64_t hi = m*D + j;
+                const bool use = (lo > plan.B1 && plan.isPrime[lo]) || (hi > plan.B1 && hi <= plan.B2 && plan.isPrime[hi]);
+                if (use == false) continue;
+
+                red.mul(r0.x, jp[j].z, u);
+                red.mul(jp[j].x, r0.z, v);
+                red.sub(u, v, u);
+                red.mul(acc, u, acc);
+            }
+
+            // r0, r1 = (m + 1)*D*p, (m + 2)*D*p
+            add(r1, pD, r0, t);
+            r0 = r1;
+            r1 = t;
+
+            if (m % 256 == 0 && stop) return;
+        }
+
+        if (gcd(acc)) {
+            found = true;
+        }
+    }
+};
+
+// f = a factor of n found by rho with nthread different c, at most maxIter steps each
+template <std::size_t Size>
+bool find_factor_rho(const ggint::TNumTmpl<Size> & n, uint64_t maxIter, int nthread, ggint::TNumTmpl<Size> & f) {
+    std::atomic<bool> stop(false);
+    std::mutex mutex;
+    std::vector<ggint::TNumTmpl<Size>> res(nthread);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < nthread; ++i) {
+        workers.emplace_back([&, i]() {
+            bool found = false;
+            ggint::with_reduction(n, Rho<Size> { n, (uint64_t) i + 1, maxIter, stop, res[i], found });
+            if (found) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stop == false) {
+                    f = res[i];
+                    stop = true;
+                }
+            }
+        });
+    }
+    for (auto & w : workers) {
+        w.join();
+    }
+
+    return stop;
+}
+
+// f = a factor of n found by one of ncurve ECM curves, nthread curves run at the same time
+template <std::size_t Size>
+bool find_factor_ecm(const ggint::TNumTmpl<Size> & n, const EcmPlan & plan, int ncurve, int nthread, uint64_t seed,
+                     ggint::TNumTmpl<Size> & f) {
+    std::atomic<bool> stop(false);
+    std::atomic<int> next(0);
+    std::mutex mutex;
+
+    auto worker = [&]() {
+        ggint::TNumTmpl<Size> res;
+        while (stop == false) {
+            const int i = next++;
+            if (i >= ncurve) break;
+
+            // sigma in [6, 2^32)
+            std::mt19937_64 rng(seed + i);
+            const uint64_t sigma = 6 + rng() % ((1ull << 32) - 6);
+
+            bool found = false;
+            ggint::with_reduction(n, EcmCurve<Size> { n, sigma, plan, stop, res, found });
+            if (found) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stop == false) {
+                    f = res;
+                    stop = true;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < nthread; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto & w : workers) {
+        w.join();
+    }
+
+    return stop;
+}
+
+// ECM bounds and number of curves that find most factors of up to the given number of decimal digits
+struct EcmLevel {
+    int digits;
+    uint64_t B1;
+    int ncurve;
+};
+
+const EcmLevel kEcmLevels[] = {
+    { 15,   2000,  25 },
+    { 20,  11000,  90 },
+    { 25,  50000, 300 },
+    { 30, 250000, 700 },
+    { 35, 1000000, 1800 },
+};
+
+struct FactorParams {
+    int nthread = 1;
+    int maxDigits = 30;          // the largest ECM level
+    uint64_t rhoIter = 1 << 20;  // rho steps per thread
+    uint64_t seed = 0;
+    bool verbose = false;
+};
+
+// Factorization of n: trial division by the small primes, then rho and ECM with growing bounds for the composite
+// cofactors. primes gets the prime factors, composites the cofactors that could not be split
+template <std::size_t Size>
+void factor(const ggint::TNumTmpl<Size> & n, const std::vector<std::size_t> & smallPrimes, const FactorParams & params,
+            std::vector<ggint::TNumTmpl<Size>> & primes, std::vector<ggint::TNumTmpl<Size>> & composites) {
+    using TNum = ggint::TNumTmpl<Size>;
+
+    TNum _1;
+    ggint::one(_1);
+
+    TNum m = n;
+    for (auto p : smallPrimes) {
+        if (ggint::less_or_equal(m, _1)) break;
+
+        std::size_t r = 0;
+        ggint::mod(p, m, r);
+        while (r == 0) {
+            TNum tp, q, t;
+            ggint::set(tp, p);
+            ggint::div(tp, m, q, t);
+            m = q;
+            primes.push_back(tp);
+            ggint::mod(p, m, r);
+        }
+    }
+
+    std::vector<TNum> todo;
+    if (ggint::less(_1, m)) todo.push_back(m);
+
+    while (todo.empty() == false) {
+        m = todo.back();
+        todo.pop_back();
+
+        if (is_prime(m, 16)) {
+            primes.push_back(m);
+            continue;
+        }
+
+        TNum f;
+        bool found = false;
+        if (params.verbose) printf("  rho on %s\n", ggint::to_string(m).c_str());
+        found = find_factor_rho(m, params.rhoIter, params.nthread, f);
+
+        for (const auto & level : kEcmLevels) {
+            if (found || level.digits > params.maxDigits) break;
+
+            if (params.verbose) printf("  ecm B1 = %d, %d curves\n", (int) level.B1, level.ncurve);
+            EcmPlan plan;
+            plan.init(level.B1, 100*level.B1);
+            found = find_factor_ecm(m, plan, level.ncurve, params.nthread, params.seed + level.B1, f);
+        }
+
+        if (found == false) {
+            composites.push_back(m);
+            continue;
+        }
+
+        if (params.verbose) printf("  found %s\n", ggint::to_string(f).c_str());
+
+        TNum q, r;
+        ggint::div(f, m, q, r);
+        todo.push_back(f);
+        todo.push_back(q);
+    }
+
+    std::sort(primes.begin(), primes.end(), [](const TNum & a, const TNum & b) { return ggint::less(a, b); });
+}
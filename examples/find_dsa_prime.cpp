@@ -0,0 +1,296 @@
+/*! \file find_dsa_prime.cpp
+ *  \brief Search for DSA / Schnorr group parameters: primes q and p = k*q + 1
+ *  \author Georgi Gerganov
+ *
+ *  q is found first. The candidates p = p0 + j*2q of one window of k are then sieved like in the sieve of
+ *  Eratosthenes: for each small prime s, p0 + j*2q = 0 mod s exactly for j = -p0/(2q) mod s, and every s-th j after
+ *  that. Only the residues of p0 and 2q mod s are needed, so the residues of the full numbers are computed once per
+ *  starting point and not for every candidate. The numbers that survive the sieve get the base-2 test and the
+ *  Miller-Rabin test, in parallel. Finally g = h^k mod p is a generator of the subgroup of order q.
+ *
+ *  Example:
+ *
+ *      ./find_dsa_prime 2048 256
+ *
+ */
+
+#include <array>
+#include <limits>
+#include <chrono>
+#include <vector>
+
+#include "ggint.h"
+#include "common.h"
+
+const std::size_t kDigits = 512; // max num : 2^(512*8) = 2^4096
+using TNum = ggint::TNumTmpl<kDigits>;
+
+// candidates j of one sieve window
+const std::size_t kWindow = 1 << 16;
+
+// sieve
+std::vector<std::size_t> smallPrimes;
+
+void add_prime(std::size_t n) {
+    for (auto p : smallPrimes) {
+        if (p*p > n) break;
+        if (n%p == 0) return;
+    }
+    smallPrimes.push_back(n);
+}
+
+void calc_small_primes(std::size_t n) {
+    smallPrimes.clear();
+    smallPrimes.push_back(2);
+    for (auto k = 3; k < n; ++k) {
+        add_prime(k);
+    }
+}
+
+// a^-1 mod m, a and m coprime
+std::size_t inverse(std::size_t a, std::size_t m) {
+    int64_t r0 = m, r1 = a % m;
+    int64_t t0 = 0, t1 = 1;
+    while (r1 != 0) {
+        const int64_t k = r0/r1;
+        const int64_t r2 = r0 - k*r1;
+        const int64_t t2 = t0 - k*t1;
+        r0 = r1; r1 = r2;
+        t0 = t1; t1 = t2;
+    }
+    return t0 < 0 ? t0 + m : t0;
+}
+
+// Sieve of the progression n0 + j*d
+// next[i] is the next j with n0 + j*d = 0 mod smallPrimes[i], relative to the start of the current window
+struct Progression {
+    TNum n0;
+    TNum d;
+    std::vector<std::size_t> next;
+
+    void init(const TNum & start, const TNum & step) {
+        n0 = start;
+        d = step;
+        next.assign(smallPrimes.size(), std::numeric_limits<std::size_t>::max());
+
+        for (std::size_t i = 0; i < smallPrimes.size(); ++i) {
+            const auto s = smallPrimes[i];
+            std::size_t rn = 0, rd = 0;
+            ggint::mod(s, n0, rn);
+            ggint::mod(s, d, rd);
+            if (rd == 0) continue;
+            next[i] = (s - rn)*inverse(rd, s) % s;
+        }
+    }
+
+    // alive[j] = 0 if n0 + j*d has a small factor, then move to the next window
+    void sieve(std::vector<uint8_t> & alive) {
+        alive.assign(kWindow, 1);
+        for (std::size_t i = 0; i < smallPrimes.size(); ++i) {
+            const auto s = smallPrimes[i];
+            auto j = next[i];
+            if (j == std::numeric_limits<std::size_t>::max()) continue;
+            for (; j < kWindow; j += s) {
+                alive[j] = 0;
+            }
+            next[i] = j - kWindow;
+        }
+    }
+
+    // n = n0 + j*d
+    void at(std::size_t j, TNum & n) const {
+        TNum t;
+        ggint::set(t, j);
+        ggint::add_mul(n0, t, d, n);
+    }
+
+    // n0 = n0 + kWindow*d
+    void advance() {
+        at(kWindow, n0);
+    }
+};
+
+// the smallest j of the window for which n0 + j*d passes test, or kWindow if there is none
+template <typename TTest>
+std::size_t first_passing(const Progression & pr, const std::vector<uint8_t> & alive, int nthread, const TTest & test) {
+    std::atomic<std::size_t> next(0);
+    std::atomic<std::size_t> best(kWindow);
+
+    auto worker = [&]() {
+        TNum n;
+        while (true) {
+            const std::size_t j = next.fetch_add(1);
+            if (j >= best) break;
+            if (alive[j] == 0) continue;
+
+            pr.at(j, n);
+            if (test(n)) {
+                auto cur = best.load();
+                while (j < cur && best.compare_exchange_weak(cur, j) == false) {}
+                break;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < nthread; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto & w : workers) {
+        w.join();
+    }
+
+    return best;
+}
+
+// random number in [lo, lo + len)
+void rand_range(const TNum & lo, const TNum & len, TNum & n) {
+    ggint::rand(n, len);
+    ggint::add(lo, n);
+}
+
+int main(int argc, char ** argv) {
+    printf("Usage: %s pbits qbits [nthread]\n", argv[0]);
+
+    srand(time(0));
+
+    int pbits = 2048;
+    int qbits = 256;
+    if (argc > 1) pbits = std::max(64, std::min(2048, atoi(argv[1])));
+    if (argc > 2) qbits = std::max(32, std::min(pbits - 16, atoi(argv[2])));
+
+    int nthread = std::max(1, (int) std::thread::hardware_concurrency());
+    if (argc > 3) nthread = std::max(1, atoi(argv[3]));
+
+    const std::size_t nsieve = std::min(1 << 24, 1 << (std::min(qbits, 24) - 4));
+    TCache cache;
+    if (cache.open(cache_path()) && load_small_primes(cache, nsieve, smallPrimes)) {
+        printf("Small primes loaded from '%s'\n", cache_path());
+    } else {
+        printf("Generating small primes for fast sieve check\n");
+        calc_small_primes(nsieve);
+    }
+    printf("Max prime in sieve = %lu\n", smallPrimes.back());
+
+    const auto tStart = std::chrono::steady_clock::now();
+
+    TNum _1, _2;
+    ggint::one(_1);
+    ggint::set(_2, 2);
+
+    std::vector<uint8_t> alive;
+    Progression pr;
+
+    // q: odd numbers q0 + 2j in [2^(qbits - 1), 2^qbits)
+    printf("Searching for %d-bit prime q ...\n", qbits);
+    TNum q;
+    {
+        TNum lo, len;
+        ggint::one(lo);
+        ggint::shbl(lo, qbits - 1);
+        len = lo;
+
+        while (true) {
+            TNum q0;
+            rand_range(lo, len, q0);
+            if (ggint::is_even(q0)) ggint::add(1, q0);
+
+            pr.init(q0, _2);
+            pr.sieve(alive);
+            const auto j = first_passing(pr, alive, nthread, [&](const TNum & n) {
+                return ggint::nbits(n) == (std::size_t) qbits && is_prime_base2(n) && is_prime(n, qbits/16);
+            });
+            if (j < kWindow) {
+                pr.at(j, q);
+                break;
+            }
+        }
+    }
+    ggint::print("q", q);
+
+    // p: p0 + j*2q with p0 = k0*q + 1, k0 even, in [2^(pbits - 1), 2^pbits)
+    printf("Searching for %d-bit prime p = k*q + 1 ...\n", pbits);
+    TNum p, k;
+    {
+        TNum lo, hi, klo, khi, r;
+        ggint::one(lo);
+        ggint::shbl(lo, pbits - 1);
+        hi = lo;
+        ggint::add(lo, hi);
+        ggint::sub(_1, hi);
+
+        ggint::div(q, lo, klo, r);
+        ggint::add(1, klo);
+        ggint::div(q, hi, khi, r);
+        ggint::sub(klo, khi);
+
+        TNum q2 = q;
+        ggint::add(q, q2);
+
+        int nstart = 0;
+        std::size_t ntested = 0;
+        bool found = false;
+        while (found == false) {
+            TNum k0, p0;
+            rand_range(klo, khi, k0);
+            if (ggint::is_odd(k0)) ggint::add(1, k0);
+            ggint::add_mul(_1, k0, q, p0);
+
+            pr.init(p0, q2);
+            ++nstart;
+
+            // stay in the range, start over from a new random k0 when leaving it
+            for (TNum pend; ; pr.advance()) {
+                pr.at(kWindow, pend);
+                if (ggint::nbits(pend) > (std::size_t) pbits) break;
+
+                pr.sieve(alive);
+                const auto j = first_passing(pr, alive, nthread, [&](const TNum & n) {
+                    return is_prime_base2(n);
+                });
+
+                for (std::size_t i = 0; i < std::min(j + 1, kWindow); ++i) ntested += alive[i];
+                printf(".");
+                fflush(stdout);
+
+                if (j < kWindow) {
+                    pr.at(j, p);
+                    if (is_prime(p, pbits/16)) {
+                        found = true;
+                        break;
+                    }
+                }
+            }
+        }
+        printf("\n");
+        printf("Tested %zu candidates that passed the sieve, %d starting points\n", ntested, nstart);
+
+        TNum t = p;
+        ggint::sub(_1, t);
+        ggint::div(q, t, k, r);
+    }
+    ggint::print("p", p);
+    ggint::print("k", k, false);
+
+    // g = h^k mod p for h = 2, 3, ... until g != 1
+    TNum g, h = _2;
+    while (true) {
+        ggint::pow_mod(h, k, p, g);
+        if (ggint::equal(g, _1) == false) break;
+        ggint::add(1, h);
+    }
+    ggint::print("g", g, false);
+
+    // g^q mod p = 1
+    {
+        TNum t;
+        ggint::pow_mod(g, q, p, t);
+        printf("g^q mod p = %s\n", ggint::to_string(t).c_str());
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+    printf("Found in %.2f s\n", elapsed);
+
+    return 0;
+}
@@ -44,8 +44,14 @@ int main(int argc, char ** argv) {
         nbits = std::min(1024, nbits);
     }
 
-    printf("Generating small primes for fast sieve check\n");
-    calc_small_primes(std::min(1 << 24, 1 << (std::min(nbits, 24) - 4)));
+    const std::size_t nsieve = std::min(1 << 24, 1 << (std::min(nbits, 24) - 4));
+    TCache cache;
+    if (cache.open(cache_path()) && load_small_primes(cache, nsieve, smallPrimes)) {
+        printf("Small primes loaded from '%s'\n", cache_path());
+    } else {
+        printf("Generating small primes for fast sieve check\n");
+        calc_small_primes(nsieve);
+    }
     printf("Max prime in sieve = %lu\n", smallPrimes.back());
 
     TNum n_lo, n_hi, _1;
@@ -1,12 +1,25 @@
 /*! \file ggint.cpp
  *  \brief Search for N-bit safe primes
  *  \author Georgi Gerganov
+ *
+ *  The search is a pipeline. The sieve runs in the main thread and pushes the candidates p = 2q + 1 that have no
+ *  small factors into a queue. Each following stage is a group of threads that pops candidates from its input
+ *  queue and pushes the survivors to the next one:
+ *
+ *      sieve -> base-2 test of q -> base-2 test of p -> Miller-Rabin test of q
+ *
+ *  The base-2 test of p together with a prime q proves that p is prime (Pocklington, q > sqrt(p) - 1), so the last
+ *  stage finds a safe prime. The other condition, gcd(2^2 - 1, p) = 1, holds for every candidate because the sieve
+ *  rejects p divisible by 3 (pmod[1]). Every few seconds the busy time of each stage and the fill level of its
+ *  input queue are printed - a stage with a full input queue and busy threads is the bottleneck and should get
+ *  more threads.
  */
 
 #include <array>
 #include <limits>
 #include <chrono>
 #include <vector>
+#include <mutex>
 
 #include "ggint.h"
 #include "common.h"
@@ -14,6 +27,18 @@
 const std::size_t kDigits = 128; // max num : 2^(128*8) = 2^1024
 using TNum = ggint::TNumTmpl<kDigits>;
 
+// capacity of the queues between the stages
+const std::size_t kQueueSize = 1024;
+
+// seconds between the statistics of the stages
+const int kReportInterval = 5;
+
+// checkpoint: the next candidate to test
+struct State {
+    TNum n;
+    uint64_t ncheck;
+};
+
 // sieve
 std::vector<std::size_t> smallPrimes;
 
@@ -33,10 +58,93 @@ void calc_small_primes(std::size_t n) {
     }
 }
 
+// p = 2q + 1
+struct Candidate {
+    TNum p;
+    TNum q;
+};
+
+using TCandidateQueue = TQueue<Candidate>;
+
+struct Stage {
+    const char * name;
+    int nthread;
+
+    TCandidateQueue * qin;
+    TCandidateQueue * qout; // nullptr for the last stage
+
+    std::atomic<uint64_t> ntested {0};
+    std::atomic<uint64_t> npassed {0};
+    std::atomic<uint64_t> busy {0}; // us
+};
+
+struct Pipeline {
+    std::atomic<bool> stop {false};
+    std::atomic<bool> found {false};
+
+    // candidates pushed by the sieve and not yet rejected or found
+    std::atomic<int64_t> inflight {0};
+
+    std::mutex mutex;
+    Candidate result;
+};
+
+// spin briefly, then sleep, while waiting on a queue
+inline void backoff(int & nmiss) {
+    if (++nmiss < 64) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+template <typename TTest>
+void run_stage(Pipeline & pl, Stage & st, TTest test) {
+    Candidate c;
+    int nmiss = 0;
+    while (pl.stop == false) {
+        if (st.qin->pop(c) == false) {
+            backoff(nmiss);
+            continue;
+        }
+        nmiss = 0;
+
+        const auto tStart = std::chrono::steady_clock::now();
+        const bool pass = test(c);
+        const auto tEnd = std::chrono::steady_clock::now();
+
+        st.busy += std::chrono::duration_cast<std::chrono::microseconds>(tEnd - tStart).count();
+        ++st.ntested;
+
+        if (pass == false) {
+            --pl.inflight;
+            continue;
+        }
+
+        ++st.npassed;
+        if (st.qout) {
+            while (st.qout->push(c) == false && pl.stop == false) {
+                backoff(nmiss);
+            }
+            nmiss = 0;
+        } else {
+            std::lock_guard<std::mutex> lock(pl.mutex);
+            if (pl.found == false) {
+                pl.result = c;
+                pl.found = true;
+            }
+            --pl.inflight;
+        }
+    }
+}
+
 int main(int argc, char ** argv) {
-    printf("Usage: %s nbits\n", argv[0]);
+    SearchParams params;
+    argc = parse_search_params(argc, argv, params);
 
-    srand(time(0));
+    printf("Usage: %s nbits [nq np nmr] [--shard i/N] [--seed S] [--checkpoint file [--resume]] [--out file]\n", argv[0]);
+    printf("    nq, np, nmr - threads of the base-2 test of q, the base-2 test of p and the Miller-Rabin test of q\n");
+    if (argc < 0) return kSearchError;
 
     int nbits = 256;
     if (argc > 1) {
@@ -44,8 +152,21 @@ int main(int argc, char ** argv) {
         nbits = std::min(512, nbits);
     }
 
-    printf("Generating small primes for fast sieve check\n");
-    calc_small_primes(std::min(1 << 24, 1 << (std::min(nbits, 24) - 4)));
+    // almost all candidates are rejected by the base-2 test of q, so it gets most of the threads by default
+    const int ncpu = std::max(1, (int) std::thread::hardware_concurrency());
+    int nthreads[3] = { std::max(1, ncpu - 3), 1, 1 };
+    for (int i = 0; i < 3 && argc > i + 2; ++i) {
+        nthreads[i] = std::max(1, atoi(argv[i + 2]));
+    }
+
+    const std::size_t nsieve = std::min(1 << 24, 1 << (std::min(nbits, 24) - 4));
+    TCache cache;
+    if (cache.open(cache_path()) && load_small_primes(cache, nsieve, smallPrimes)) {
+        printf("Small primes loaded from '%s'\n", cache_path());
+    } else {
+        printf("Generating small primes for fast sieve check\n");
+        calc_small_primes(nsieve);
+    }
     printf("Max prime in sieve = %lu\n", smallPrimes.back());
 
     TNum n_lo, n_hi, _1;
@@ -56,26 +177,151 @@ int main(int argc, char ** argv) {
     ggint::shbl(n_hi, nbits);
     ggint::sub(n_lo, n_hi);
 
-    TNum n;
+    // candidates of this shard: [n_lo, n_lo + n_hi)
+    {
+        TNum len, t, r;
+        ggint::set(t, params.nshard);
+        ggint::div(t, n_hi, len, r);
+        ggint::set(t, params.shard);
+        ggint::mul(len, t, r);
+        ggint::add(r, n_lo);
+        if (params.shard + 1 < params.nshard) {
+            n_hi = len;
+        } else {
+            ggint::sub(r, n_hi);
+        }
+    }
+    TNum n_end = n_lo;
+    ggint::add(n_hi, n_end);
+
+    State state;
+    ggint::zero(state.n);
+    state.ncheck = 0;
+    if (params.resume && load_checkpoint(params, "safe_prime", state)) {
+        printf("Resuming after %d checked numbers\n", (int) state.ncheck);
+    }
+
+    // each shard draws its own random candidates
+    if (params.hasSeed == false) {
+        params.seed = time(0);
+    }
+    srand(shard_seed(params));
+
+    catch_interrupts();
+
+    TNum n = state.n;
     TNum n2;
-    ggint::zero(n);
     std::vector<bool> to_add(smallPrimes.back());
     std::vector<std::size_t> pmod(smallPrimes.back());
     std::vector<std::size_t> pmod2(smallPrimes.back());
 
-    printf("Searching for %d-bit safe prime ...\n", nbits);
+    const std::size_t trials = nbits/16;
+
+    TCandidateQueue qq(kQueueSize), qp(kQueueSize), qmr(kQueueSize);
+
+    Pipeline pl;
+    Stage stages[3];
+    stages[0].name = "base2(q)"; stages[0].qin = &qq;  stages[0].qout = &qp;
+    stages[1].name = "base2(p)"; stages[1].qin = &qp;  stages[1].qout = &qmr;
+    stages[2].name = "mr(q)";    stages[2].qin = &qmr; stages[2].qout = nullptr;
+    for (int i = 0; i < 3; ++i) {
+        stages[i].nthread = nthreads[i];
+    }
+
+    printf("Searching for %d-bit safe prime using %d + %d + %d + 1 threads ...\n", nbits, nthreads[0], nthreads[1], nthreads[2]);
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < nthreads[0]; ++i) {
+        workers.emplace_back([&]() { run_stage(pl, stages[0], [](const Candidate & c) { return is_prime_base2(c.q); }); });
+    }
+    for (int i = 0; i < nthreads[1]; ++i) {
+        workers.emplace_back([&]() { run_stage(pl, stages[1], [](const Candidate & c) { return is_prime_base2(c.p); }); });
+    }
+    for (int i = 0; i < nthreads[2]; ++i) {
+        workers.emplace_back([&]() { run_stage(pl, stages[2], [&](const Candidate & c) { return is_prime(c.q, trials); }); });
+    }
+
+    auto tStart = std::chrono::steady_clock::now();
+    auto tSave = tStart;
+    auto tReport = tStart;
+
+    uint64_t sieveBusy = 0; // us
 
-    auto tStart = std::chrono::high_resolution_clock::now();
-    auto tEnd = std::chrono::high_resolution_clock::now();
+    auto report = [&](std::chrono::steady_clock::time_point tCur) {
+        const double elapsed = std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::microseconds>(tCur - tStart).count());
+        printf("[%5d s] sieve: %d checked, %3d%% busy",
+               (int) (elapsed/1e6), (int) state.ncheck, (int) (100.0*sieveBusy/elapsed));
+        for (const auto & st : stages) {
+            printf(" | %s: %d thr, %3d%% busy, queue %3d%%, %d/%d passed",
+                   st.name, st.nthread, (int) (100.0*st.busy/(elapsed*st.nthread)),
+                   (int) (100*st.qin->size()/st.qin->capacity()), (int) st.npassed, (int) st.ntested);
+        }
+        printf("\n");
+        fflush(stdout);
+    };
+
+    // wait until every candidate pushed so far has been tested, so that the checkpoint does not skip any of them
+    auto drain = [&]() {
+        while (pl.inflight > 0 && pl.found == false) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    auto advance = [&]() {
+        ++state.ncheck;
+        ggint::add(4, n);
+        ggint::add(2, n2);
+
+        pmod[1] += 4; pmod[1] %= 3;
+        pmod2[1] += 2; pmod2[1] %= 3;
+        for (auto i = 2; i < smallPrimes.size(); ++i) {
+            auto p = smallPrimes[i];
+            pmod[i] += 4;
+            if (pmod[i] >= p) pmod[i] -= p;
+            pmod2[i] += 2;
+            if (pmod2[i] >= p) pmod2[i] -= p;
+        }
+    };
+
+    const uint64_t ncheck0 = state.ncheck;
+
+    int status = kSearchFound;
+    bool resumed = ggint::is_zero(n) == false;
+    while (pl.found == false) {
+        auto tCur = std::chrono::steady_clock::now();
+        if (interrupted() || std::chrono::duration_cast<std::chrono::seconds>(tCur - tSave).count() >= params.interval) {
+            drain();
+            if (pl.found) break;
+
+            state.n = n;
+            save_checkpoint(params, "safe_prime", state);
+            tSave = tCur;
+
+            if (interrupted()) {
+                printf("\nInterrupted after %d checked numbers\n", (int) state.ncheck);
+                status = kSearchInterrupted;
+                break;
+            }
+        }
+        if (std::chrono::duration_cast<std::chrono::seconds>(tCur - tReport).count() >= kReportInterval) {
+            report(tCur);
+            tReport = tCur;
+        }
+
+        // start over from a new random point when leaving the shard
+        if (ggint::less_or_equal(n_end, n)) {
+            ggint::zero(n);
+        }
 
-    std::size_t ncheck = 0;
-    while (true) {
-        if (ggint::is_zero(n)) {
-            ggint::rand(n, n_hi);
-            ggint::add(n_lo, n);
-            if (ggint::is_even(n)) {
-                ggint::add(1, n);
+        if (ggint::is_zero(n) || resumed) {
+            if (resumed == false) {
+                ggint::rand(n, n_hi);
+                ggint::add(n_lo, n);
+                if (ggint::is_even(n)) {
+                    ggint::add(1, n);
+                }
             }
+            resumed = false;
 
             n2 = n;
             ggint::sub(_1, n2);
@@ -96,83 +342,57 @@ int main(int argc, char ** argv) {
             }
         }
 
-        auto tCur = std::chrono::high_resolution_clock::now();
-
-        bool do_fast = true;
-        while (true) {
+        // stop at the end of the shard, the outer loop then starts over from a new random point
+        bool survivor = false;
+        while (ggint::less_or_equal(n_end, n) == false) {
+            survivor = true;
             for (auto i = 0; i < smallPrimes.size(); ++i) {
                 if (pmod[i] == 0 || pmod2[i] == 0) {
-                    do_fast = false;
+                    survivor = false;
                     break;
                 }
             }
-            if (do_fast == false) {
-                ++ncheck;
-                ggint::add(4, n);
-                ggint::add(2, n2);
-
-                pmod[1] += 4; pmod[1] %= 3;
-                pmod2[1] += 2; pmod2[1] %= 3;
-                for (auto i = 2; i < smallPrimes.size(); ++i) {
-                    auto p = smallPrimes[i];
-                    pmod[i] += 4;
-                    if (pmod[i] >= p) pmod[i] -= p;
-                    pmod2[i] += 2;
-                    if (pmod2[i] >= p) pmod2[i] -= p;
-                }
-                do_fast = true;
-                continue;
-            } else {
-                break;
-            }
+            if (survivor) break;
+            advance();
         }
 
-        {
-            //printf("ncheck = %d\n", (int) ncheck);
-            tEnd = std::chrono::high_resolution_clock::now();
-            //printf("Fast check: %d us\n", (int) std::chrono::duration_cast<std::chrono::microseconds>(tEnd - tCur).count());
-        }
+        sieveBusy += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tCur).count();
 
-        bool is_safe_prime = true;
-        if (is_prime(n, 3) && is_prime(n2, 3) && is_prime(n, nbits/16) && is_prime(n2, nbits/16)) {
-        } else {
-            is_safe_prime = false;
-            printf(".");
-            fflush(stdout);
-        }
+        if (survivor == false) continue;
 
-        if (is_safe_prime) {
-            printf("\nFound safe prime p:\n");
-            ggint::print("p", n);
-            ggint::print("(p-1)/2", n2);
-            break;
+        // hand the survivor over to the test stages
+        ++pl.inflight;
+        {
+            Candidate c { n, n2 };
+            int nmiss = 0;
+            while (qq.push(c) == false && pl.found == false) {
+                backoff(nmiss);
+            }
         }
 
-        ++ncheck;
-        ggint::add(4, n);
-        ggint::add(2, n2);
+        advance();
+    }
 
-        pmod[1] += 4; pmod[1] %= 3;
-        pmod2[1] += 2; pmod2[1] %= 3;
-        for (auto i = 2; i < smallPrimes.size(); ++i) {
-            auto p = smallPrimes[i];
-            pmod[i] += 4;
-            if (pmod[i] >= p) pmod[i] -= p;
-            pmod2[i] += 2;
-            if (pmod2[i] >= p) pmod2[i] -= p;
-        }
+    pl.stop = true;
+    for (auto & w : workers) {
+        w.join();
+    }
 
-        {
-            tEnd = std::chrono::high_resolution_clock::now();
-            //printf("Time: %d us\n", (int) std::chrono::duration_cast<std::chrono::microseconds>(tEnd - tStart).count());
-        }
+    auto tEnd = std::chrono::steady_clock::now();
+    report(tEnd);
 
+    if (pl.found) {
+        printf("\nFound safe prime p:\n");
+        ggint::print("p", pl.result.p);
+        ggint::print("(p-1)/2", pl.result.q);
+        save_result(params, "p = " + ggint::to_string(pl.result.p) + "\n");
     }
 
     {
         auto t = std::chrono::duration_cast<std::chrono::milliseconds>(tEnd - tStart).count();
-        printf("Checked %d numbers in %d ms: %g num/sec\n", (int) ncheck, (int) t, 1000.0*((double)(ncheck))/t);
+        const uint64_t ncheck = state.ncheck - ncheck0;
+        printf("Checked %d numbers in %d ms: %g num/sec\n", (int) ncheck, (int) t, 1000.0*((double)(ncheck))/std::max(1, (int) t));
     }
 
-    return 0;
+    return status;
 }
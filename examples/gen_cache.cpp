@@ -0,0 +1,128 @@
+/*! \file gen_cache.cpp
+ *  \brief Generate the precomputation cache of the examples
+ *  \author Georgi Gerganov
+ *
+ *  The cache has the small primes of the sieves and the powers of the dlp generator. The examples load it from the
+ *  file in GGINT_CACHE, or "ggint.cache" in the working directory, and compute everything themselves without it.
+ *
+ *  Example:
+ *
+ *      ./gen_cache ggint.cache
+ *      GGINT_CACHE=ggint.cache ./find_safe_prime 512
+ *
+ */
+
+#include "ggint.h"
+#include "common.h"
+
+#include <string>
+#include <vector>
+
+struct Section {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+// uint32_t limit followed by all primes below limit, sieve of Eratosthenes
+Section small_primes(uint32_t limit) {
+    std::vector<bool> composite(limit);
+    std::vector<uint32_t> res { limit };
+    for (uint64_t i = 2; i < limit; ++i) {
+        if (composite[i]) continue;
+        res.push_back(i);
+        for (uint64_t j = i*i; j < limit; j += i) composite[j] = true;
+    }
+
+    Section sec { "primes", {} };
+    sec.data.resize(res.size()*sizeof(uint32_t));
+    memcpy(sec.data.data(), res.data(), sec.data.size());
+
+    return sec;
+}
+
+// g, p and g^(2^i) mod p for the dlp example
+Section dlp_powers() {
+    using TNum = ggint::TNumTmpl<kDlpDigits>;
+
+    TNum g, p;
+    ggint::zero(g);
+    ggint::zero(p);
+    std::copy(std::begin(kDlpGenerator), std::end(kDlpGenerator), g.begin());
+    std::copy(std::begin(kDlpPrime), std::end(kDlpPrime), p.begin());
+
+    std::vector<TNum> table;
+    fixed_base_table(g, p, kDlpExpBits, table);
+    table.insert(table.begin(), { g, p });
+
+    Section sec { "dlp", {} };
+    sec.data.resize(table.size()*sizeof(TNum));
+    memcpy(sec.data.data(), table.data(), sec.data.size());
+
+    return sec;
+}
+
+bool save_cache(const char * fname, const std::vector<Section> & sections) {
+    const std::size_t n = sections.size();
+
+    std::vector<CacheSection> table(n);
+    std::size_t offset = sizeof(CacheHeader) + n*sizeof(CacheSection);
+    for (std::size_t i = 0; i < n; ++i) {
+        memset(&table[i], 0, sizeof(table[i]));
+        strncpy(table[i].name, sections[i].name.c_str(), sizeof(table[i].name) - 1);
+        offset = (offset + kCacheAlign - 1)/kCacheAlign*kCacheAlign;
+        table[i].offset = offset;
+        table[i].size = sections[i].data.size();
+        offset += table[i].size;
+    }
+
+    std::vector<uint8_t> buf(offset, 0);
+    memcpy(buf.data() + sizeof(CacheHeader), table.data(), n*sizeof(CacheSection));
+    for (std::size_t i = 0; i < n; ++i) {
+        std::copy(sections[i].data.begin(), sections[i].data.end(), buf.begin() + table[i].offset);
+    }
+
+    CacheHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, "ggpc", 4);
+    hdr.version = kCacheVersion;
+    hdr.nsection = n;
+    hdr.size = buf.size();
+    hdr.checksum = checksum(buf.data() + sizeof(hdr), buf.size() - sizeof(hdr));
+    memcpy(buf.data(), &hdr, sizeof(hdr));
+
+    // processes that have the old file mapped keep it until they exit
+    const std::string tmp = std::string(fname) + ".tmp";
+    FILE * f = fopen(tmp.c_str(), "wb");
+    if (f == nullptr) return false;
+    bool ok = fwrite(buf.data(), buf.size(), 1, f) == 1;
+    ok = (fclose(f) == 0) && ok;
+
+    return ok && rename(tmp.c_str(), fname) == 0;
+}
+
+int main(int argc, char ** argv) {
+    printf("Usage: %s [file] [nsieve]\n", argv[0]);
+
+    const char * fname = argc > 1 ? argv[1] : cache_path();
+
+    // the largest sieve of find_prime and find_safe_prime
+    uint32_t nsieve = 1 << 20;
+    if (argc > 2) {
+        nsieve = std::max(3, std::min(1 << 30, atoi(argv[2])));
+    }
+
+    std::vector<Section> sections;
+    sections.push_back(small_primes(nsieve));
+    sections.push_back(dlp_powers());
+
+    if (save_cache(fname, sections) == false) {
+        fprintf(stderr, "Failed to write '%s'\n", fname);
+        return 1;
+    }
+
+    printf("Written '%s': %zu primes below %u, %zu powers of the dlp generator\n", fname,
+           sections[0].data.size()/sizeof(uint32_t) - 1, nsieve, kDlpExpBits);
+
+    TCache cache;
+    return cache.open(fname) ? 0 : 1;
+}
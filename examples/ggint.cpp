@@ -72,6 +72,50 @@ int main() {
         ggint::print("a^x mod n", r);
     }
 
+    {
+        TNum g; ggint::zero(g); g[0] = 105; g[1] = 17;
+        TNum h; ggint::zero(h); h[0] = 3;   h[2] = 201;
+        TNum x; ggint::zero(x); x[0] = 131; x[3] = 77;
+        TNum y; ggint::zero(y); y[0] = 250; y[1] = 9;
+        TNum n; ggint::zero(n); n[0] = 7;   n[4] = 1;
+        TNum gx, hy, t, r;
+        ggint::pow_mod(g, x, n, gx);
+        ggint::pow_mod(h, y, n, hy);
+        ggint::mul(gx, hy, t);
+        ggint::mod(n, t, r);
+        ggint::print("g^x*h^y mod n", r);
+        ggint::multi_pow_mod(g, x, h, y, n, r);
+        ggint::print("g^x*h^y mod n", r);
+
+        TNum _2; ggint::set(_2, 2);
+        ggint::pow_mod(_2, x, n, r);
+        ggint::print("2^x mod n", r);
+        ggint::pow2_mod(x, n, r);
+        ggint::print("2^x mod n", r);
+    }
+
+    {
+        // modulus with the top bit set
+        using T8 = ggint::TNumTmpl<8>;
+        T8 x, n, _2, r0, r1;
+        ggint::set(x, 0x3240b6);
+        ggint::set(n, 0xbc83c286dd9c8ca0ull);
+        ggint::set(_2, 2);
+        ggint::pow_mod(_2, x, n, r0);
+        ggint::pow2_mod(x, n, r1);
+        printf("pow2_mod == pow_mod : %d\n", ggint::equal(r0, r1) ? 1 : 0);
+
+        // (n - 1) + (n - 2) mod n = n - 3
+        ggint::TModular<8> red;
+        red.init(n);
+        T8 a = n, b = n, c, d = n, k;
+        ggint::set(k, 1); ggint::sub(k, a);
+        ggint::set(k, 2); ggint::sub(k, b);
+        ggint::set(k, 3); ggint::sub(k, d);
+        red.add(a, b, c);
+        printf("TModular::add == n - 3 : %d\n", ggint::equal(c, d) ? 1 : 0);
+    }
+
     {
         TNum a; ggint::zero(a); a[0] = 184;
         TNum p;
@@ -80,6 +124,16 @@ int main() {
         ggint::print("p", p);
     }
 
+    {
+        // 64k-bit operands, above the NTT threshold
+        using TBig = ggint::TNumTmpl<1 << 14>;
+        static TBig a, b, p0, p1;
+        for (std::size_t i = 0; i < a.size()/2; ++i) { a[i] = rand()%256; b[i] = rand()%256; }
+        ggint::mul(a, b, p0);
+        ggint::ntt::mul(p1.data(), p1.size(), a.data(), a.size()/2, b.data(), b.size()/2);
+        printf("ntt::mul == mul : %d\n", ggint::equal(p0, p1) ? 1 : 0);
+    }
+
     {
         TNum a; ggint::zero(a); a[0] = 173;
         std::size_t r;
@@ -88,5 +142,18 @@ int main() {
         printf("r = %lu\n", r);
     }
 
+    {
+        using TInt = ggint::TBigInt<32>;
+        TInt a = 184, b = 65537, c = 1000003;
+        TInt m = TInt(0) - 189; // 2^256 - 189
+        TInt r = a*b % m;
+        print("a*b mod m", r);
+        r = r*r % m;
+        print("(a*b)^2 mod m", r);
+        r = a + b*c;
+        print("a + b*c", r);
+        print("a^c mod m", pow_mod(a, c, m));
+    }
+
     return 0;
 }
@@ -5,15 +5,37 @@
 
 #pragma once
 
-#include <map>
 #include <array>
 #include <limits>
+#include <algorithm>
 #include <random>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+// 64-bit word kernels need a 128-bit product type and little-endian digit order
+#if defined(__SIZEOF_INT128__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && !defined(GGINT_NO_WORDS)
+#define GGINT_WORDS
+// the bodies of the unrolled word kernels are small only after their loop indices are folded, so they have to be
+// inlined no matter what the heuristics of the compiler say
+#define GGINT_INLINE __attribute__((always_inline))
+#endif
+
+#if defined(GGINT_WORDS) && defined(__x86_64__) && !defined(GGINT_NO_ASM)
+#define GGINT_ASM_X86_64
+#include <cpuid.h>
+#endif
 
 namespace ggint {
 
     using TDigit = uint8_t;
     using TOverflow = uint16_t;
+    using TAccum = uint64_t; // column sums of digit products
 
     template <std::size_t Size>
         using TNumTmpl = std::array<TDigit, Size>;
@@ -21,6 +43,158 @@ namespace ggint {
     constexpr std::size_t kDigitBits = 8*sizeof(TDigit);
     constexpr TOverflow kDigitMax = (TOverflow)(std::numeric_limits<TDigit>::max()) + 1;
 
+#ifdef GGINT_WORDS
+    using TWord = uint64_t;
+    using TWide = unsigned __int128;
+
+    constexpr std::size_t kWordDigits = sizeof(TWord)/sizeof(TDigit);
+
+    namespace mpn {
+
+        // f(I), f(I + 1), ..., f(N - 1)
+        // the index is a plain argument, but after inlining it is a constant in every copy of the body
+        template <std::size_t I, std::size_t N>
+            struct TUnroll {
+                template <typename F>
+                    GGINT_INLINE static inline void run(const F & f) {
+                        f(I);
+                        TUnroll<I + 1, N>::run(f);
+                    }
+            };
+
+        template <std::size_t N>
+            struct TUnroll<N, N> {
+                template <typename F>
+                    GGINT_INLINE static inline void run(const F &) {}
+            };
+
+        // numbers of up to this many words use the unrolled kernels
+        constexpr std::size_t kFixedWords = 8;
+
+        // Kernels for N words, N known at compile time
+        // For 64 to 512-bit numbers the loop counters, the calls through the kernel table and the length checks
+        // cost more than the arithmetic. With the loops unrolled the operands and the column accumulators of
+        // the products can stay in registers. p must not overlap the inputs of the products
+        template <std::size_t N>
+            struct TFixed {
+                // w = a, word by word, so that the stores of one kernel can be forwarded to the loads of the next
+                GGINT_INLINE static inline void load(TWord * w, const TDigit * a) {
+                    TUnroll<0, N>::run([&](std::size_t i) GGINT_INLINE { std::memcpy(w + i, a + i*sizeof(TWord), sizeof(TWord)); });
+                }
+
+                // a = w
+                GGINT_INLINE static inline void store(TDigit * a, const TWord * w) {
+                    TUnroll<0, N>::run([&](std::size_t i) GGINT_INLINE { std::memcpy(a + i*sizeof(TWord), w + i, sizeof(TWord)); });
+                }
+
+                // p = a*b or a*a, the lowest M words
+                // Comba like mul_generic, the products below the diagonal of a square are added twice
+                template <std::size_t M, bool Sqr>
+                    GGINT_INLINE static inline void comba(TWord * p, const TWord * a, const TWord * b) {
+                        TWide acc = 0;
+                        TWord hi = 0;
+                        TUnroll<0, M>::run([&](std::size_t k) GGINT_INLINE {
+                            TUnroll<0, N>::run([&](std::size_t i) GGINT_INLINE {
+                                if (i > k || k - i >= N || (Sqr && 2*i > k)) return;
+                                TWide t = (TWide) a[i]*b[k - i];
+                                if (Sqr && 2*i < k) {
+                                    hi += (TWord) (t >> 127);
+                                    t <<= 1;
+                                }
+                                acc += t;
+                                hi += acc < t;
+                            });
+                            p[k] = (TWord) acc;
+                            acc = (acc >> 64) | ((TWide) hi << 64);
+                            hi = 0;
+                        });
+                    }
+
+                // p = a*b, 2N words
+                GGINT_INLINE static inline void mul(TWord * p, const TWord * a, const TWord * b) { comba<2*N, false>(p, a, b); }
+
+                // p = a*b mod 2^(64N)
+                GGINT_INLINE static inline void mullo(TWord * p, const TWord * a, const TWord * b) { comba<N, false>(p, a, b); }
+
+                // p = a*a, 2N words
+                GGINT_INLINE static inline void sqr(TWord * p, const TWord * a) { comba<2*N, true>(p, a, a); }
+
+                // p = a*a mod 2^(64N)
+                GGINT_INLINE static inline void sqrlo(TWord * p, const TWord * a) { comba<N, true>(p, a, a); }
+
+                // r = a + b, return carry
+                GGINT_INLINE static inline TWord add_n(TWord * r, const TWord * a, const TWord * b) {
+                    TWord c = 0;
+                    TUnroll<0, N>::run([&](std::size_t i) GGINT_INLINE {
+                        TWide s = (TWide) a[i] + b[i] + c;
+                        r[i] = (TWord) s;
+                        c = (TWord) (s >> 64);
+                    });
+                    return c;
+                }
+
+                // r = a - b, return borrow
+                GGINT_INLINE static inline TWord sub_n(TWord * r, const TWord * a, const TWord * b) {
+                    TWord c = 0;
+                    TUnroll<0, N>::run([&](std::size_t i) GGINT_INLINE {
+                        TWide s = (TWide) a[i] - b[i] - c;
+                        r[i] = (TWord) s;
+                        c = (TWord) (s >> 64) & 1;
+                    });
+                    return c;
+                }
+
+                // r = a + b mod n, a, b < n
+                GGINT_INLINE static inline void add_mod(TWord * r, const TWord * a, const TWord * b, const TWord * n) {
+                    TWord s[N], d[N];
+                    const TWord c = add_n(s, a, b);
+                    const bool ge = sub_n(d, s, n) == 0 || c != 0;
+                    TUnroll<0, N>::run([&](std::size_t i) GGINT_INLINE { r[i] = ge ? d[i] : s[i]; });
+                }
+
+                // r = t/R mod n, R = 2^(64N), t < n*R has 2N words and is destroyed, ninv = -n^-1 mod 2^64
+                GGINT_INLINE static inline void redc(TWord * r, TWord * t, const TWord * n, TWord ninv) {
+                    TWord top = 0;
+                    TUnroll<0, N>::run([&](std::size_t i) GGINT_INLINE {
+                        const TWord m = t[i]*ninv;
+                        TWord c = 0;
+                        TUnroll<0, N>::run([&](std::size_t j) GGINT_INLINE {
+                            TWide s = (TWide) n[j]*m + t[i + j] + c;
+                            t[i + j] = (TWord) s;
+                            c = (TWord) (s >> 64);
+                        });
+                        TWide s = (TWide) t[i + N] + c + top;
+                        t[i + N] = (TWord) s;
+                        top = (TWord) (s >> 64);
+                    });
+
+                    TWord d[N];
+                    const bool ge = sub_n(d, t + N, n) == 0 || top != 0;
+                    TUnroll<0, N>::run([&](std::size_t i) GGINT_INLINE { r[i] = ge ? d[i] : t[i + N]; });
+                }
+
+                // z = x*y/R mod n, z can be x or y
+                GGINT_INLINE static inline void mont_mul(TWord * z, const TWord * x, const TWord * y, const TWord * n, TWord ninv) {
+                    TWord t[2*N];
+                    mul(t, x, y);
+                    redc(z, t, n, ninv);
+                }
+
+                // z = x*x/R mod n, z can be x
+                GGINT_INLINE static inline void mont_sqr(TWord * z, const TWord * x, const TWord * n, TWord ninv) {
+                    TWord t[2*N];
+                    sqr(t, x);
+                    redc(z, t, n, ninv);
+                }
+            };
+
+        // words of a number of size digits for TFixed, 0 if it does not fill a small number of words
+        constexpr std::size_t fixed_words(std::size_t size) {
+            return size % kWordDigits == 0 && size/kWordDigits <= kFixedWords ? size/kWordDigits : 0;
+        }
+    }
+#endif
+
     // a = 0
     template<std::size_t Size>
         void zero(TNumTmpl<Size> & a) {
@@ -46,9 +220,80 @@ namespace ggint {
             }
         }
 
+    // a = number in str, decimal or hexadecimal with "0x" prefix
+    // return false if str is not a number or the number does not fit in a
+    template<std::size_t Size>
+        bool parse(const char * str, TNumTmpl<Size> & a) {
+            a.fill(0);
+            while (*str == ' ' || *str == '\t') ++str;
+
+            TOverflow base = 10;
+            if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+                base = 16;
+                str += 2;
+            }
+
+            // a = a*base^k + (next k characters), k = 12 at a time and only over the n used digits of a
+            constexpr int kChunk = 12;
+            bool any = false;
+            std::size_t n = 0;
+            for (int k = kChunk; k == kChunk; ) {
+                uint64_t chunk = 0, mult = 1;
+                for (k = 0; k < kChunk; ++k, ++str) {
+                    uint64_t d = 0;
+                    if      (*str >= '0' && *str <= '9') d = *str - '0';
+                    else if (*str >= 'a' && *str <= 'f') d = *str - 'a' + 10;
+                    else if (*str >= 'A' && *str <= 'F') d = *str - 'A' + 10;
+                    else break;
+                    if (d >= base) return false;
+                    chunk = chunk*base + d;
+                    mult *= base;
+                }
+                if (k == 0) break;
+
+                uint64_t r = chunk;
+                for (std::size_t i = 0; i < n; ++i) {
+                    const uint64_t x = a[i]*mult + r;
+                    a[i] = x % kDigitMax;
+                    r = x / kDigitMax;
+                }
+                for (; r != 0 && n < Size; ++n) {
+                    a[n] = r % kDigitMax;
+                    r /= kDigitMax;
+                }
+                if (r != 0) return false;
+                any = true;
+            }
+
+            while (*str == ' ' || *str == '\t' || *str == '\r' || *str == '\n') ++str;
+
+            return any && *str == 0;
+        }
+
+    // number of significant digits in a
+    template<std::size_t Size>
+        std::size_t ndigits(const TNumTmpl<Size> & a) {
+            for (auto i = Size; i > 0; --i) {
+                if (a[i - 1] != 0) return i;
+            }
+            return 0;
+        }
+
     // b = b + a
     template<std::size_t Size>
         void add(const TNumTmpl<Size> & a, TNumTmpl<Size> & b) {
+#ifdef GGINT_WORDS
+            constexpr std::size_t W = mpn::fixed_words(Size);
+            if (W > 0) {
+                using TFixed = mpn::TFixed<W>;
+                std::array<TWord, W> aw, bw;
+                TFixed::load(aw.data(), a.data());
+                TFixed::load(bw.data(), b.data());
+                TFixed::add_n(bw.data(), bw.data(), aw.data());
+                TFixed::store(b.data(), bw.data());
+                return;
+            }
+#endif
             TDigit r = 0;
             for (auto i = 0; i < Size; ++i) {
                 TOverflow x = b[i];
@@ -77,6 +322,18 @@ namespace ggint {
     // b = b - a
     template<std::size_t Size>
         void sub(const TNumTmpl<Size> & a, TNumTmpl<Size> & b) {
+#ifdef GGINT_WORDS
+            constexpr std::size_t W = mpn::fixed_words(Size);
+            if (W > 0) {
+                using TFixed = mpn::TFixed<W>;
+                std::array<TWord, W> aw, bw;
+                TFixed::load(aw.data(), a.data());
+                TFixed::load(bw.data(), b.data());
+                TFixed::sub_n(bw.data(), bw.data(), aw.data());
+                TFixed::store(b.data(), bw.data());
+                return;
+            }
+#endif
             TDigit r = 0;
             for (auto i = 0; i < Size; ++i) {
                 if (b[i] >= a[i] + r) {
@@ -170,232 +427,2380 @@ namespace ggint {
             }
         }
 
-    // p = b * a
-    template<std::size_t Size>
-        void mul(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b, TNumTmpl<Size> & p) {
-            TNumTmpl<Size> t;
-            zero(p);
-            for (auto i = 0; i < Size; ++i) {
-                t = b;
-                mul(a[i], t);
-                shl(t, i);
-                add(t, p);
+    // Thread pool for the products of long operands
+    // Off by default - set_num_threads(n) starts n - 1 workers and the calling thread does its share of the work.
+    // One parallel operation runs at a time: calls from other threads while the pool is busy and calls from inside a
+    // task return false and the caller does the work serially. Idle workers spin for a while before they sleep, so
+    // that the back-to-back products of an exponentiation do not pay for a wake-up each time
+    class TThreadPool {
+        public:
+            ~TThreadPool() { resize(1); }
+
+            std::size_t size() const { return nworker + 1; }
+
+            void resize(std::size_t n) {
+                std::lock_guard<std::mutex> lockBusy(busy);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    quit = true;
+                }
+                cv.notify_all();
+                for (auto & w : workers) w.join();
+                workers.clear();
+
+                quit = false;
+                nworker = n > 1 ? n - 1 : 0;
+                for (std::size_t i = 0; i < nworker; ++i) {
+                    workers.emplace_back([this]() { loop(); });
+                }
             }
-        }
 
-    // a == b
-    template<std::size_t Size>
-        bool equal(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b) {
-            for (auto i = 0; i < Size; ++i) {
-                if (a[i] != b[i]) return false;
+            // call f(i) for i in [0, n) on all threads, return false if nothing was done
+            bool run(std::size_t n, const std::function<void(std::size_t)> & f) {
+                if (nworker == 0 || inside() || busy.try_lock() == false) return false;
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    while (nactive > 0) std::this_thread::yield();
+                    job = &f;
+                    njob = n;
+                    next = 0;
+                    ndone = 0;
+                    ++generation;
+                }
+                cv.notify_all();
+
+                work(&f, n);
+                while (ndone < n || nactive > 0) std::this_thread::yield();
+
+                busy.unlock();
+                return true;
             }
-            return true;
-        }
 
-    // a < b
-    template<std::size_t Size>
-        bool less(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b) {
-            for (auto i = Size - 1; ; --i) {
-                if (a[i] < b[i]) return true;
-                if (a[i] > b[i]) return false;
-                if (i == 0) break;
+        private:
+            static bool & inside() {
+                static thread_local bool flag = false;
+                return flag;
             }
-            return false;
-        }
 
-    // a <= b
-    template<std::size_t Size>
-        bool less_or_equal(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b) {
-            for (auto i = Size - 1; ; --i) {
-                if (a[i] < b[i]) return true;
-                if (a[i] > b[i]) return false;
-                if (i == 0) break;
+            void work(const std::function<void(std::size_t)> * f, std::size_t n) {
+                inside() = true;
+                for (std::size_t i = next++; i < n; i = next++) {
+                    (*f)(i);
+                    ++ndone;
+                }
+                inside() = false;
             }
-            return true;
-        }
 
-    // a == 0
-    template<std::size_t Size>
-        bool is_zero(const TNumTmpl<Size> & a) {
-            for (auto i = 0; i < Size; ++i) {
-                if (a[i] != 0) return false;
+            void loop() {
+                uint64_t seen = 0;
+                while (true) {
+                    for (int i = 0; i < (1 << 16) && generation == seen && quit == false; ++i) {
+                        std::this_thread::yield();
+                    }
+
+                    const std::function<void(std::size_t)> * f = nullptr;
+                    std::size_t n = 0;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        cv.wait(lock, [&]() { return quit || generation != seen; });
+                        if (quit) return;
+                        seen = generation;
+                        f = job;
+                        n = njob;
+                        ++nactive;
+                    }
+                    work(f, n);
+                    --nactive;
+                }
             }
-            return true;
-        }
 
-    // a & 1 == 0
-    template<std::size_t Size>
-        bool is_even(const TNumTmpl<Size> & a) {
-            return (a[0] & 1) == 0;
-        }
+            std::size_t nworker = 0;
+            std::vector<std::thread> workers;
 
-    // a & 1 == 1
-    template<std::size_t Size>
-        bool is_odd(const TNumTmpl<Size> & a) {
-            return (a[0] & 1) == 1;
-        }
+            std::mutex busy;
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::atomic<bool> quit {false};
 
-    // b / a = q, b % a = r
-    template<std::size_t Size>
-        void div(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b, TNumTmpl<Size> & q, TNumTmpl<Size> & r) {
-            zero(q);
-            zero(r);
-            TNumTmpl<Size> t;
+            const std::function<void(std::size_t)> * job = nullptr;
+            std::size_t njob = 0;
+            std::atomic<uint64_t> generation {0};
+            std::atomic<std::size_t> next {0};
+            std::atomic<std::size_t> ndone {0};
+            std::atomic<int> nactive {0};
+    };
 
-            for (auto i = Size - 1; ; --i) {
-                shl(r);
-                add(b[i], r);
-                if (less_or_equal(a, r)) {
-                    t = a;
-                    TDigit k = 0;
-                    do {
-                        ++k;
-                        add(a, t);
-                    } while (less_or_equal(t, r));
-                    q[i] = k;
-                    sub(a, t);
-                    sub(t, r);
+    inline TThreadPool & pool() {
+        static TThreadPool p;
+        return p;
+    }
+
+    // number of threads used by a single long multiplication, 1 - serial (default)
+    inline void set_num_threads(std::size_t n) { pool().resize(n); }
+    inline std::size_t get_num_threads() { return pool().size(); }
+
+    // Number theoretic transform multiplication
+    // The numbers are split into 32-bit coefficients and their cyclic convolution is computed with NTTs modulo three
+    // primes p = c*2^k + 1, k >= 23. The coefficients of the product are below min(na, nb)*2^64 < p0*p1*p2, so
+    // they are recovered exactly with the Chinese remainder theorem (Garner) and the carries are propagated.
+    // O(n log n) instead of O(n^2), used by mul and the word kernels for long operands
+    namespace ntt {
+
+        constexpr uint32_t kP0 = 998244353; // 119*2^23 + 1
+        constexpr uint32_t kP1 = 167772161; //   5*2^25 + 1
+        constexpr uint32_t kP2 = 469762049; //   7*2^26 + 1
+        constexpr uint32_t kRoot = 3;       // primitive root of all three
+
+        // longest transform, limited by kP0
+        constexpr std::size_t kMaxLength = std::size_t(1) << 23;
+
+        // digits of the shorter operand from which the transform is faster than the byte schoolbook product
+        // the word kernels have their own thresholds
+        constexpr std::size_t kMulThreshold = 128;
+
+        template <uint32_t P>
+            inline uint32_t mul_mod(uint32_t a, uint32_t b) {
+                return (uint64_t) a*b % P;
+            }
+
+        template <uint32_t P>
+            inline uint32_t pow_mod(uint32_t a, uint64_t e) {
+                uint32_t r = 1;
+                while (e > 0) {
+                    if (e & 1) r = mul_mod<P>(r, a);
+                    a = mul_mod<P>(a, a);
+                    e >>= 1;
+                }
+                return r;
+            }
+
+        // w[half + j] = root^j, root of unity of order 2*half, for each stage of the transform of length n
+        // wq = w*2^32/P, so that x*w mod P is computed with 32-bit multiplications (Shoup)
+        template <uint32_t P>
+            struct TTwiddles {
+                std::vector<uint32_t> w;
+                std::vector<uint32_t> wq;
+            };
+
+        // the table of the last length is kept per thread
+        template <uint32_t P>
+            const TTwiddles<P> & twiddles(std::size_t n) {
+                static thread_local TTwiddles<P> t;
+                if (t.w.size() == n) return t;
+
+                t.w.assign(n, 1);
+                t.wq.assign(n, 0);
+                uint32_t root = pow_mod<P>(kRoot, (P - 1)/n);
+                for (std::size_t half = n/2; half > 0; half /= 2) {
+                    for (std::size_t j = 1; j < half; ++j) t.w[half + j] = mul_mod<P>(t.w[half + j - 1], root);
+                    root = mul_mod<P>(root, root);
+                }
+                for (std::size_t j = 1; j < n; ++j) t.wq[j] = (uint32_t) (((uint64_t) t.w[j] << 32)/P);
+
+                return t;
+            }
+
+        // in-place transform, a.size() is a power of 2
+        // the inverse is the forward transform with the outputs 1..n-1 reversed and divided by the length
+        template <uint32_t P>
+            void transform(std::vector<uint32_t> & a, bool inverse) {
+                const std::size_t n = a.size();
+
+                for (std::size_t i = 1, j = 0; i < n; ++i) {
+                    std::size_t bit = n >> 1;
+                    for (; j & bit; bit >>= 1) j ^= bit;
+                    j ^= bit;
+                    if (i < j) std::swap(a[i], a[j]);
+                }
+
+                const auto & tw = twiddles<P>(n);
+                for (std::size_t half = 1; half < n; half *= 2) {
+                    const uint32_t * w = tw.w.data() + half;
+                    const uint32_t * wq = tw.wq.data() + half;
+                    for (std::size_t i = 0; i < n; i += 2*half) {
+                        uint32_t * x = a.data() + i;
+                        uint32_t * y = x + half;
+                        for (std::size_t j = 0; j < half; ++j) {
+                            const uint32_t q = (uint32_t) (((uint64_t) y[j]*wq[j]) >> 32);
+                            uint32_t v = y[j]*w[j] - q*P;
+                            if (v >= P) v -= P;
+
+                            const uint32_t u = x[j];
+                            x[j] = u + v >= P ? u + v - P : u + v;
+                            y[j] = u >= v ? u - v : u + P - v;
+                        }
+                    }
+                }
+
+                if (inverse) {
+                    std::reverse(a.begin() + 1, a.end());
+                    const uint32_t ninv = pow_mod<P>(n % P, P - 2);
+                    for (auto & x : a) x = mul_mod<P>(x, ninv);
+                }
+            }
+
+        // r = a*b mod P, cyclic convolution of length n. Empty b means b = a
+        template <uint32_t P>
+            void convolve(const std::vector<uint32_t> & a, const std::vector<uint32_t> & b, std::size_t n, std::vector<uint32_t> & r) {
+                r.assign(n, 0);
+                for (std::size_t i = 0; i < a.size(); ++i) r[i] = a[i] % P;
+                transform<P>(r, false);
+
+                if (b.empty()) {
+                    for (auto & x : r) x = mul_mod<P>(x, x);
                 } else {
-                    q[i] = 0;
+                    std::vector<uint32_t> t(n, 0);
+                    for (std::size_t i = 0; i < b.size(); ++i) t[i] = b[i] % P;
+                    transform<P>(t, false);
+                    for (std::size_t i = 0; i < n; ++i) r[i] = mul_mod<P>(r[i], t[i]);
                 }
-                if (i == 0) break;
+
+                transform<P>(r, true);
+            }
+
+        // little-endian 32-bit coefficients of the n digits in a
+        inline std::vector<uint32_t> split(const TDigit * a, std::size_t n) {
+            std::vector<uint32_t> c((n + 3)/4, 0);
+            for (std::size_t i = 0; i < n; ++i) {
+                c[i/4] |= (uint32_t) a[i] << (8*(i%4));
             }
+            return c;
         }
 
-    // b % a = r
-    template<std::size_t Size>
-        void mod(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b, TNumTmpl<Size> & r) {
-            if (less(b, a)) {
-                r = b;
-                return;
+        // p = a*b, the product truncated or zero padded to np digits
+        // return false if the operands are too long for the transform
+        inline bool mul(TDigit * p, std::size_t np, const TDigit * a, std::size_t na, const TDigit * b, std::size_t nb) {
+            const bool square = a == b && na == nb;
+
+            const auto ca = split(a, na);
+            const auto cb = square ? std::vector<uint32_t>() : split(b, nb);
+            const std::size_t nc = ca.size() + (square ? ca.size() : cb.size()) - 1;
+
+            std::size_t n = 1;
+            while (n < nc) n <<= 1;
+            if (n > kMaxLength) return false;
+
+            // one prime per thread
+            std::vector<uint32_t> r0, r1, r2;
+            auto task = [&](std::size_t i) {
+                if (i == 0) convolve<kP0>(ca, cb, n, r0);
+                if (i == 1) convolve<kP1>(ca, cb, n, r1);
+                if (i == 2) convolve<kP2>(ca, cb, n, r2);
+            };
+            if (pool().run(3, task) == false) {
+                for (std::size_t i = 0; i < 3; ++i) task(i);
             }
 
-            zero(r);
-            TNumTmpl<Size> t;
+            // Garner: v = x01 + p0*p1*t2, x01 = r0 + p0*t1
+            const uint32_t inv01 = pow_mod<kP1>(kP0 % kP1, kP1 - 2);
+            const uint64_t p01 = (uint64_t) kP0*kP1;
+            const uint32_t inv012 = pow_mod<kP2>(p01 % kP2, kP2 - 2);
 
-            static auto lastnum = a;
-            static std::map<TDigit, TNumTmpl<Size>> cache;
+            uint64_t carry = 0;
+            for (std::size_t k = 0; 4*k < np; ++k) {
+                uint64_t s = carry;
+                uint64_t hi = 0;
+                if (k < nc) {
+                    const uint32_t t1 = mul_mod<kP1>(r1[k] + kP1 - r0[k] % kP1, inv01);
+                    const uint64_t x01 = r0[k] + (uint64_t) kP0*t1;
+                    const uint32_t t2 = mul_mod<kP2>(r2[k] + kP2 - x01 % kP2, inv012);
 
-            if (cache.empty() || equal(a, lastnum) == false) {
-                zero(t);
-                for (int k = 0; k <= kDigitMax; ++k) {
-                    cache[k] = t;
-                    add(a, t);
+                    s += x01 + (p01 & 0xffffffff)*t2;
+                    hi = (p01 >> 32)*t2;
+                }
+                carry = (s >> 32) + hi;
+
+                for (std::size_t i = 0; i < 4 && 4*k + i < np; ++i) {
+                    p[4*k + i] = (TDigit) (s >> (8*i));
                 }
-                lastnum = a;
             }
 
-            for (auto i = Size - 1; ; --i) {
-                shl(r);
-                add(b[i], r);
+            return true;
+        }
+    }
 
-                if (less_or_equal(a, r)) {
-                    if (less_or_equal(cache[kDigitMax - 1], r)) {
-                        sub(cache[kDigitMax - 1], r);
-                    } else {
-                        int k0 = 0;
-                        int k1 = kDigitMax;
-                        while (true) {
-                            int m = (k0 + k1)/2;
-                            if (less_or_equal(cache[m], r)) {
-                                k0 = m;
-                            } else {
-                                k1 = m;
-                            }
-                            if (k1 == k0 + 1) break;
-                        };
-                        sub(cache[k0], r);
-                    }
-                }
-                if (i == 0) break;
+#ifdef GGINT_WORDS
+    // Word level kernels
+    // Numbers whose Size is a multiple of the word size are also processed as arrays of 64-bit words. The kernels
+    // take pointer + length arguments like the GMP mpn layer. The implementation is selected once at startup:
+    // MULX/ADX assembly on x86-64 CPUs that support it and portable C++ otherwise
+    namespace mpn {
+
+        // a <=> b, n words
+        inline int cmp(const TWord * a, const TWord * b, std::size_t n) {
+            for (auto i = n; i > 0; --i) {
+                if (a[i - 1] != b[i - 1]) return a[i - 1] < b[i - 1] ? -1 : 1;
             }
+            return 0;
         }
 
-    // b % a = r
-    template<std::size_t Size>
-        void mod(std::size_t a, const TNumTmpl<Size> & b, std::size_t & r) {
-            r = 0;
-            for (auto i = Size - 1; ; --i) {
-                r = (r*kDigitMax + b[i]) % a;
-                if (i == 0) break;
+        // r = a - b, n words, return borrow
+        inline TWord sub_n(TWord * r, const TWord * a, const TWord * b, std::size_t n) {
+            TWord c = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                TWord x = a[i] - b[i];
+                TWord c1 = x > a[i];
+                r[i] = x - c;
+                c = c1 + (r[i] > x);
             }
+            return c;
         }
 
-    // generate random number a
-    template<std::size_t Size>
-        void rand(TNumTmpl<Size> & a) {
-            for (auto & d : a) {
-                d = std::rand() % kDigitMax;
+        // r = a + b, n words, return carry
+        inline TWord add_n(TWord * r, const TWord * a, const TWord * b, std::size_t n) {
+            TWord c = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                TWord x = a[i] + b[i];
+                TWord c1 = x < a[i];
+                r[i] = x + c;
+                c = c1 + (r[i] < x);
             }
+            return c;
         }
 
-    // generate random number a < b
-    template<std::size_t Size>
-        void rand(TNumTmpl<Size> & a, const TNumTmpl<Size> b) {
-            for (auto & d : a) {
-                d = std::rand() % kDigitMax;
+        // number of significant words in a
+        inline std::size_t size(const TWord * a, std::size_t n) {
+            while (n > 0 && a[n - 1] == 0) --n;
+            return n;
+        }
+
+        // q = a/m, r = a mod m, q can be nullptr
+        // a has na + 1 words, the last one is scratch, and is destroyed. m has nm words with m[nm - 1] != 0,
+        // na >= nm, q has na - nm + 1 words, r has nm words, t is scratch of nm words
+        // Knuth's algorithm D: m and a are shifted so that the top bit of m is set, then each quotient word
+        // estimated from the top two words of the remainder is off by at most 2
+        inline void divrem(TWord * q, TWord * r, TWord * a, std::size_t na, const TWord * m, std::size_t nm, TWord * t) {
+            const int s = __builtin_clzll(m[nm - 1]);
+            auto shl = [s](TWord * y, const TWord * x, std::size_t n) {
+                TWord c = 0;
+                for (std::size_t i = 0; i < n && s > 0; ++i) {
+                    TWord w = x[i];
+                    y[i] = (w << s) | c;
+                    c = w >> (64 - s);
+                }
+                if (s == 0) std::copy(x, x + n, y);
+                return c;
+            };
+            shl(t, m, nm);
+            a[na] = shl(a, a, na);
+
+            const TWord d1 = t[nm - 1];
+            const TWord d0 = nm > 1 ? t[nm - 2] : 0;
+            for (auto j = na - nm + 1; j > 0; --j) {
+                TWord * u = a + j - 1;
+
+                TWide num = ((TWide) u[nm] << 64) | u[nm - 1];
+                TWide qh = num/d1;
+                TWide rh = num - qh*d1;
+                while ((qh >> 64) != 0 || (nm > 1 && qh*d0 > ((rh << 64) | u[nm - 2]))) {
+                    --qh;
+                    rh += d1;
+                    if ((rh >> 64) != 0) break;
+                }
+
+                // u = u - qh*t
+                const TWord qw = (TWord) qh;
+                TWord c = 0, b = 0;
+                for (std::size_t i = 0; i <= nm; ++i) {
+                    TWide p = i < nm ? (TWide) qw*t[i] + c : c;
+                    c = (TWord) (p >> 64);
+                    TWord x = u[i] - (TWord) p;
+                    TWord b1 = x > u[i];
+                    u[i] = x - b;
+                    b = b1 + (u[i] > x);
+                }
+
+                // the estimate was one too big
+                TWord qj = qw;
+                if (b != 0) {
+                    --qj;
+                    u[nm] += add_n(u, u, t, nm);
+                }
+                if (q) q[j - 1] = qj;
             }
 
-            auto t = a;
-            TNumTmpl<Size> q;
-            div(b, t, q, a);
+            for (std::size_t i = 0; i < nm; ++i) {
+                r[i] = s == 0 ? a[i] : (a[i] >> s) | (i + 1 < nm ? a[i + 1] << (64 - s) : 0);
+            }
         }
 
-    // r = a^x mod n
-    template<std::size_t Size>
-        void pow_mod(TNumTmpl<Size> a, TNumTmpl<Size> x, const TNumTmpl<Size> & n, TNumTmpl<Size> & r) {
-            TNumTmpl<Size> t;
-            one(r);
-            zero(t);
+        // r = gcd(u, v), u and v are nonzero, have n words and are destroyed, r has n words
+        // binary gcd: both numbers are kept odd and the larger one is replaced with the difference, which is even
+        inline void gcd(TWord * r, TWord * u, TWord * v, std::size_t n) {
+            // a = a >> ctz(a) with a != 0, return the shift
+            auto strip = [n](TWord * a) {
+                std::size_t i = 0;
+                while (a[i] == 0) ++i;
+                const int s = __builtin_ctzll(a[i]);
+                for (std::size_t j = 0; j + i < n; ++j) {
+                    a[j] = s == 0 ? a[j + i] : (a[j + i] >> s) | (j + i + 1 < n ? a[j + i + 1] << (64 - s) : 0);
+                }
+                std::fill(a + n - i, a + n, 0);
+                return 64*i + s;
+            };
 
-            while (is_zero(x) == false) {
-                if (is_odd(x)) {
-                    mul(a, r, t);
-                    mod(n, t, r);
+            const std::size_t sh = std::min(strip(u), strip(v));
+            std::size_t nu = size(u, n);
+            std::size_t nv = size(v, n);
+            while (true) {
+                const int c = nu != nv ? (nu < nv ? -1 : 1) : cmp(u, v, nu);
+                if (c == 0) break;
+                if (c > 0) {
+                    std::swap(u, v);
+                    std::swap(nu, nv);
                 }
-                shbr(x, 1);
-                mul(a, a, t);
-                mod(n, t, a);
+                sub_n(v, v, u, nv);
+                strip(v);
+                nv = size(v, nv);
+            }
+
+            // r = u << sh, fits in n words since r <= min(u, v)
+            const std::size_t w = sh/64;
+            const int s = sh % 64;
+            std::fill(r, r + n, 0);
+            for (std::size_t i = 0; i < nu && i + w < n; ++i) {
+                r[i + w] |= u[i] << s;
+                if (s > 0 && i + w + 1 < n) r[i + w + 1] = u[i] >> (64 - s);
             }
         }
 
-    // print number: array of bytes and decimal representation
-    template<std::size_t Size>
-        void print(const char * pref, TNumTmpl<Size> x, bool printBytes = true) {
-            int n = 0;
-            for (n = x.size() - 1; n >= 0; --n) {
-                if (x[n] != 0) break;
+        // p = a*b, n words, return carry
+        inline TWord mul_1_generic(TWord * p, const TWord * a, std::size_t n, TWord b) {
+            TWord c = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                TWide t = (TWide) a[i]*b + c;
+                p[i] = (TWord) t;
+                c = (TWord) (t >> 64);
+            }
+            return c;
+        }
+
+        // p = p + a*b, n words, return carry
+        inline TWord addmul_1_generic(TWord * p, const TWord * a, std::size_t n, TWord b) {
+            TWord c = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                TWide t = (TWide) a[i]*b + p[i] + c;
+                p[i] = (TWord) t;
+                c = (TWord) (t >> 64);
             }
+            return c;
+        }
 
-            if (printBytes) {
-                printf(" - %16s : ", pref);
-                for (int i = 0; i <= n; ++i) {
-                    printf("%3d ", x[i]);
+        // p = a*b, na + nb words
+        // Comba: the products of each column go into a three word accumulator
+        inline void mul_generic(TWord * p, const TWord * a, std::size_t na, const TWord * b, std::size_t nb) {
+            TWide acc = 0;
+            TWord hi = 0;
+            for (std::size_t k = 0; k + 1 < na + nb; ++k) {
+                const std::size_t i0 = k < nb ? 0 : k - nb + 1;
+                const std::size_t i1 = std::min(k + 1, na);
+                for (auto i = i0; i < i1; ++i) {
+                    TWide t = (TWide) a[i]*b[k - i];
+                    acc += t;
+                    hi += acc < t;
                 }
-                printf("\n");
+                p[k] = (TWord) acc;
+                acc = (acc >> 64) | ((TWide) hi << 64);
+                hi = 0;
             }
+            p[na + nb - 1] = (TWord) acc;
+        }
 
-            {
-                TNumTmpl<Size> _10, q, r;
-                set(_10, 10);
-                std::array<char, 4096> str;
-                str.fill(0);
-
-                int n = 0;
-                if (printBytes) {
-                    printf("   %16s : ", "Decimal");
-                } else {
-                    printf(" - %16s : ", pref);
+        // p = a*a, 2n words
+        // Comba: the products below the diagonal of each column are summed once and doubled
+        inline void sqr_generic(TWord * p, const TWord * a, std::size_t n) {
+            TWide acc = 0;
+            TWord hi = 0;
+            for (std::size_t k = 0; k + 1 < 2*n; ++k) {
+                const std::size_t i0 = k < n ? 0 : k - n + 1;
+
+                TWide s = 0;
+                TWord sh = 0;
+                for (auto i = i0; 2*i < k; ++i) {
+                    TWide t = (TWide) a[i]*a[k - i];
+                    s += t;
+                    sh += s < t;
                 }
-                while (is_zero(x) == false) {
-                    div(_10, x, q, r);
-                    x = q;
-                    str[n++] = '0' + r[0];
+                sh = (sh << 1) | (TWord) (s >> 127);
+                s <<= 1;
+
+                if (k % 2 == 0) {
+                    TWide t = (TWide) a[k/2]*a[k/2];
+                    s += t;
+                    sh += s < t;
                 }
-                for (int i = n - 1; i >= 0; --i) {
-                    printf("%c", str[i]);
+
+                acc += s;
+                hi += (acc < s) + sh;
+
+                p[k] = (TWord) acc;
+                acc = (acc >> 64) | ((TWide) hi << 64);
+                hi = 0;
+            }
+            p[2*n - 1] = (TWord) acc;
+        }
+
+        // p = 2*p + a[0]^2 + a[1]^2*2^128 + ..., 2n words
+        // completes a square from the sum of the products above the diagonal
+        inline void sqr_diagonal(TWord * p, const TWord * a, std::size_t n) {
+            TWord c = 0;
+            for (std::size_t i = 0; i < 2*n; ++i) {
+                TWord x = p[i];
+                p[i] = (x << 1) | c;
+                c = x >> 63;
+            }
+
+            c = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                TWide t = (TWide) a[i]*a[i];
+                TWide s = (TWide) p[2*i] + (TWord) t + c;
+                p[2*i] = (TWord) s;
+                s = (TWide) p[2*i + 1] + (TWord) (t >> 64) + (TWord) (s >> 64);
+                p[2*i + 1] = (TWord) s;
+                c = (TWord) (s >> 64);
+            }
+        }
+
+        // r = t/R mod n, R = 2^(64k), t < n*R has 2k words and is destroyed, ninv = -n^-1 mod 2^64
+        // Montgomery reduction: one word of t is cleared per addmul_1 pass
+        template <TWord (*AddMul1)(TWord *, const TWord *, std::size_t, TWord)>
+            inline void redc_1_tmpl(TWord * r, TWord * t, const TWord * n, std::size_t k, TWord ninv) {
+                TWord top = 0;
+                for (std::size_t i = 0; i < k; ++i) {
+                    TWord c = AddMul1(t + i, n, k, t[i]*ninv);
+                    TWord s = t[i + k] + c;
+                    TWord cy = s < c;
+                    s += top;
+                    cy += s < top;
+                    t[i + k] = s;
+                    top = cy;
                 }
-                printf("\n");
+
+                if (top != 0 || cmp(t + k, n, k) >= 0) {
+                    sub_n(r, t + k, n, k);
+                } else {
+                    std::copy(t + k, t + 2*k, r);
+                }
+            }
+
+        inline void redc_1_generic(TWord * r, TWord * t, const TWord * n, std::size_t k, TWord ninv) {
+            redc_1_tmpl<addmul_1_generic>(r, t, n, k, ninv);
+        }
+
+#ifdef GGINT_ASM_X86_64
+        // MULX leaves the flags untouched and ADCX/ADOX carry through CF and OF respectively, so the high word
+        // of the previous product and the digit of p are added in two independent carry chains. The main loop
+        // handles 4 words per iteration, its counter runs up to 0 and is tested with JRCXZ, which does not touch
+        // the flags either
+
+        // p = a*b, n words, return carry
+        inline TWord mul_1_adx(TWord * p, const TWord * a, std::size_t n, TWord b) {
+            TWord c;
+            TWord n4 = -(TWord) (n/4);
+            TWord n1 = -(TWord) (n%4);
+            __asm__ volatile (
+                "xorl %k[c], %k[c]\n\t"
+                "jrcxz 3f\n\t"
+                "1:\n\t"
+                "mulxq 0(%[a]), %%r8, %%r9\n\t"
+                "adcxq %[c], %%r8\n\t"
+                "movq %%r8, 0(%[p])\n\t"
+                "mulxq 8(%[a]), %%r8, %[c]\n\t"
+                "adcxq %%r9, %%r8\n\t"
+                "movq %%r8, 8(%[p])\n\t"
+                "mulxq 16(%[a]), %%r8, %%r9\n\t"
+                "adcxq %[c], %%r8\n\t"
+                "movq %%r8, 16(%[p])\n\t"
+                "mulxq 24(%[a]), %%r8, %[c]\n\t"
+                "adcxq %%r9, %%r8\n\t"
+                "movq %%r8, 24(%[p])\n\t"
+                "leaq 32(%[a]), %[a]\n\t"
+                "leaq 32(%[p]), %[p]\n\t"
+                "leaq 1(%%rcx), %%rcx\n\t"
+                "jrcxz 3f\n\t"
+                "jmp 1b\n\t"
+                "3:\n\t"
+                "movq %[n1], %%rcx\n\t"
+                "jrcxz 5f\n\t"
+                "4:\n\t"
+                "mulxq (%[a]), %%r8, %%r9\n\t"
+                "adcxq %[c], %%r8\n\t"
+                "movq %%r8, (%[p])\n\t"
+                "movq %%r9, %[c]\n\t"
+                "leaq 8(%[a]), %[a]\n\t"
+                "leaq 8(%[p]), %[p]\n\t"
+                "leaq 1(%%rcx), %%rcx\n\t"
+                "jrcxz 5f\n\t"
+                "jmp 4b\n\t"
+                "5:\n\t"
+                "movl $0, %%r8d\n\t"
+                "adcxq %%r8, %[c]\n\t"
+                : [c] "=&r" (c), [a] "+r" (a), [p] "+r" (p), "+c" (n4)
+                : [n1] "r" (n1), "d" (b)
+                : "r8", "r9", "cc", "memory");
+            return c;
+        }
+
+        // p = p + a*b, n words, return carry
+        inline TWord addmul_1_adx(TWord * p, const TWord * a, std::size_t n, TWord b) {
+            TWord c;
+            TWord n4 = -(TWord) (n/4);
+            TWord n1 = -(TWord) (n%4);
+            __asm__ volatile (
+                "xorl %k[c], %k[c]\n\t"
+                "jrcxz 3f\n\t"
+                "1:\n\t"
+                "mulxq 0(%[a]), %%r8, %%r9\n\t"
+                "adcxq %[c], %%r8\n\t"
+                "adoxq 0(%[p]), %%r8\n\t"
+                "movq %%r8, 0(%[p])\n\t"
+                "mulxq 8(%[a]), %%r8, %[c]\n\t"
+                "adcxq %%r9, %%r8\n\t"
+                "adoxq 8(%[p]), %%r8\n\t"
+                "movq %%r8, 8(%[p])\n\t"
+                "mulxq 16(%[a]), %%r8, %%r9\n\t"
+                "adcxq %[c], %%r8\n\t"
+                "adoxq 16(%[p]), %%r8\n\t"
+                "movq %%r8, 16(%[p])\n\t"
+                "mulxq 24(%[a]), %%r8, %[c]\n\t"
+                "adcxq %%r9, %%r8\n\t"
+                "adoxq 24(%[p]), %%r8\n\t"
+                "movq %%r8, 24(%[p])\n\t"
+                "leaq 32(%[a]), %[a]\n\t"
+                "leaq 32(%[p]), %[p]\n\t"
+                "leaq 1(%%rcx), %%rcx\n\t"
+                "jrcxz 3f\n\t"
+                "jmp 1b\n\t"
+                "3:\n\t"
+                "movq %[n1], %%rcx\n\t"
+                "jrcxz 5f\n\t"
+                "4:\n\t"
+                "mulxq (%[a]), %%r8, %%r9\n\t"
+                "adcxq %[c], %%r8\n\t"
+                "adoxq (%[p]), %%r8\n\t"
+                "movq %%r8, (%[p])\n\t"
+                "movq %%r9, %[c]\n\t"
+                "leaq 8(%[a]), %[a]\n\t"
+                "leaq 8(%[p]), %[p]\n\t"
+                "leaq 1(%%rcx), %%rcx\n\t"
+                "jrcxz 5f\n\t"
+                "jmp 4b\n\t"
+                "5:\n\t"
+                "movl $0, %%r8d\n\t"
+                "adcxq %%r8, %[c]\n\t"
+                "adoxq %%r8, %[c]\n\t"
+                : [c] "=&r" (c), [a] "+r" (a), [p] "+r" (p), "+c" (n4)
+                : [n1] "r" (n1), "d" (b)
+                : "r8", "r9", "cc", "memory");
+            return c;
+        }
+
+        // p = a*b, na + nb words
+        // one MULX/ADX row per word of a - the dual carry chains make operand scanning faster than Comba here
+        inline void mul_adx(TWord * p, const TWord * a, std::size_t na, const TWord * b, std::size_t nb) {
+            p[nb] = mul_1_adx(p, b, nb, a[0]);
+            for (std::size_t i = 1; i < na; ++i) {
+                p[nb + i] = addmul_1_adx(p + i, b, nb, a[i]);
             }
         }
+
+        // p = a*a, 2n words
+        // the products above the diagonal are accumulated row by row, doubled and the squares are added
+        // short operands use Comba, where the doubling pass does not pay off
+        inline void sqr_adx(TWord * p, const TWord * a, std::size_t n) {
+            if (n < 8) {
+                sqr_generic(p, a, n);
+                return;
+            }
+
+            p[0] = 0;
+            p[n] = n > 1 ? mul_1_adx(p + 1, a + 1, n - 1, a[0]) : 0;
+            for (std::size_t i = 1; i + 1 < n; ++i) {
+                p[n + i] = addmul_1_adx(p + 2*i + 1, a + i + 1, n - i - 1, a[i]);
+            }
+            p[2*n - 1] = 0;
+
+            sqr_diagonal(p, a, n);
+        }
+
+        inline void redc_1_adx(TWord * r, TWord * t, const TWord * n, std::size_t k, TWord ninv) {
+            redc_1_tmpl<addmul_1_adx>(r, t, n, k, ninv);
+        }
+#endif
+
+        struct TKernels {
+            const char * name;
+
+            TWord (*mul_1)    (TWord * p, const TWord * a, std::size_t n, TWord b);
+            TWord (*addmul_1) (TWord * p, const TWord * a, std::size_t n, TWord b);
+            void  (*mul)      (TWord * p, const TWord * a, std::size_t na, const TWord * b, std::size_t nb);
+            void  (*sqr)      (TWord * p, const TWord * a, std::size_t n);
+            void  (*redc_1)   (TWord * r, TWord * t, const TWord * n, std::size_t k, TWord ninv);
+
+            // words of the shorter operand from which ntt::mul is faster than mul
+            std::size_t nttThreshold;
+        };
+
+        inline TKernels select_kernels() {
+#ifdef GGINT_ASM_X86_64
+            unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+            if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_BMI2) && (ebx & bit_ADX)) {
+                return { "mulx/adx", mul_1_adx, addmul_1_adx, mul_adx, sqr_adx, redc_1_adx, 1536 };
+            }
+#endif
+            return { "generic", mul_1_generic, addmul_1_generic, mul_generic, sqr_generic, redc_1_generic, 768 };
+        }
+
+        // the kernels for this CPU, selected on first use
+        inline const TKernels & kernels() {
+            static const TKernels k = select_kernels();
+            return k;
+        }
+
+        inline TWord mul_1(TWord * p, const TWord * a, std::size_t n, TWord b) { return kernels().mul_1(p, a, n, b); }
+        inline TWord addmul_1(TWord * p, const TWord * a, std::size_t n, TWord b) { return kernels().addmul_1(p, a, n, b); }
+
+        // words of the shorter operand from which the schoolbook products are split between the threads of the pool
+        constexpr std::size_t kParallelThreshold = 128;
+
+        inline bool parallel(std::size_t n) {
+            return n >= kParallelThreshold && pool().size() > 1;
+        }
+
+        // p = p + a*B^i, a has n words, carry propagated to the top of p
+        inline void add_at(TWord * p, std::size_t np, const TWord * a, std::size_t n, std::size_t i) {
+            TWord c = add_n(p + i, p + i, a, n);
+            for (i += n; c != 0 && i < np; ++i) {
+                p[i] += c;
+                c = p[i] < c;
+            }
+        }
+
+        // p = a*b, na >= nb
+        // the rows of a are split between the threads, each part goes to its own buffer and the parts are added
+        inline bool mul_parallel(TWord * p, const TWord * a, std::size_t na, const TWord * b, std::size_t nb) {
+            const std::size_t len = (na + pool().size() - 1)/pool().size();
+            const std::size_t nparts = (na + len - 1)/len;
+
+            std::vector<std::vector<TWord>> parts(nparts);
+            auto task = [&](std::size_t i) {
+                const std::size_t n = std::min(len, na - i*len);
+                parts[i].resize(n + nb);
+                kernels().mul(parts[i].data(), a + i*len, n, b, nb);
+            };
+            if (pool().run(nparts, task) == false) return false;
+
+            std::fill(p, p + na + nb, 0);
+            for (std::size_t i = 0; i < nparts; ++i) {
+                add_at(p, na + nb, parts[i].data(), parts[i].size(), i*len);
+            }
+
+            return true;
+        }
+
+        // p = a*a, 2n words
+        // the triangle of products above the diagonal is split in row ranges of equal area
+        inline bool sqr_parallel(TWord * p, const TWord * a, std::size_t n) {
+            const std::size_t nt = pool().size();
+
+            std::vector<std::size_t> rows(1, 0);
+            {
+                const std::size_t total = n*(n - 1)/2;
+                std::size_t area = 0;
+                for (std::size_t i = 0; i + 1 < n; ++i) {
+                    area += n - i - 1;
+                    if (rows.size() < nt && area*nt >= total*rows.size()) rows.push_back(i + 1);
+                }
+                if (rows.back() != n - 1) rows.push_back(n - 1);
+            }
+
+            // rows [r0, r1) cover the words [2*r0 + 1, r1 + n) of p
+            const std::size_t nparts = rows.size() - 1;
+            std::vector<std::vector<TWord>> parts(nparts);
+            auto task = [&](std::size_t j) {
+                const std::size_t r0 = rows[j], r1 = rows[j + 1];
+                auto & t = parts[j];
+                t.resize(r1 + n - 2*r0 - 1);
+                for (auto i = r0; i < r1; ++i) {
+                    TWord * q = t.data() + 2*(i - r0);
+                    q[n - i - 1] = i == r0 ? kernels().mul_1(q, a + i + 1, n - i - 1, a[i]) :
+                                             kernels().addmul_1(q, a + i + 1, n - i - 1, a[i]);
+                }
+            };
+            if (pool().run(nparts, task) == false) return false;
+
+            std::fill(p, p + 2*n, 0);
+            for (std::size_t j = 0; j < nparts; ++j) {
+                add_at(p, 2*n, parts[j].data(), parts[j].size(), 2*rows[j] + 1);
+            }
+            sqr_diagonal(p, a, n);
+
+            return true;
+        }
+
+        // words of the blocks of mul_blocks, the longest operands whose product fits in one transform
+        constexpr std::size_t kNttBlock = ntt::kMaxLength/4;
+
+        inline void mul(TWord * p, const TWord * a, std::size_t na, const TWord * b, std::size_t nb);
+
+        // p = a*b for operands too long for one transform, na >= nb
+        // the products of all pairs of blocks are added at their offsets. The blocks of b have at most kNttBlock
+        // words and the blocks of a fill the rest of the longest transform
+        inline void mul_blocks(TWord * p, const TWord * a, std::size_t na, const TWord * b, std::size_t nb) {
+            const std::size_t lenb = std::min(nb, kNttBlock);
+            const std::size_t lena = 2*kNttBlock - lenb;
+            std::vector<TWord> t(2*kNttBlock);
+            std::fill(p, p + na + nb, 0);
+            for (std::size_t i = 0; i < na; i += lena) {
+                const std::size_t la = std::min(lena, na - i);
+                for (std::size_t j = 0; j < nb; j += lenb) {
+                    const std::size_t lb = std::min(lenb, nb - j);
+                    mul(t.data(), a + i, la, b + j, lb);
+                    add_at(p, na + nb, t.data(), la + lb, i + j);
+                }
+            }
+        }
+
+        // requires na > 0, nb > 0, p must not overlap a or b
+        inline void mul(TWord * p, const TWord * a, std::size_t na, const TWord * b, std::size_t nb) {
+            if (na < nb) {
+                std::swap(a, b);
+                std::swap(na, nb);
+            }
+            if (nb >= kernels().nttThreshold) {
+                if (ntt::mul((TDigit *) p, (na + nb)*kWordDigits, (const TDigit *) a, na*kWordDigits, (const TDigit *) b, nb*kWordDigits)) {
+                    return;
+                }
+                mul_blocks(p, a, na, b, nb);
+                return;
+            }
+            if (parallel(nb) && mul_parallel(p, a, na, b, nb)) {
+                return;
+            }
+            kernels().mul(p, a, na, b, nb);
+        }
+
+        // requires n > 0, p must not overlap a
+        inline void sqr(TWord * p, const TWord * a, std::size_t n) {
+            if (n >= kernels().nttThreshold) {
+                if (ntt::mul((TDigit *) p, 2*n*kWordDigits, (const TDigit *) a, n*kWordDigits, (const TDigit *) a, n*kWordDigits)) {
+                    return;
+                }
+                mul_blocks(p, a, n, a, n);
+                return;
+            }
+            if (parallel(n) && sqr_parallel(p, a, n)) {
+                return;
+            }
+            kernels().sqr(p, a, n);
+        }
+
+        inline void redc_1(TWord * r, TWord * t, const TWord * n, std::size_t k, TWord ninv) { kernels().redc_1(r, t, n, k, ninv); }
+
+        // r = t*R^-1 mod n, R = 2^(64k), t < n*R has 2k words and is overwritten, nprime = -n^-1 mod R
+        // Montgomery reduction with two full products instead of k dependent rows, so that it can use the threads
+        inline void redc_n(TWord * r, TWord * t, const TWord * n, std::size_t k, const TWord * nprime) {
+            std::vector<TWord> q(2*k), u(2*k);
+            mul(q.data(), t, k, nprime, k);
+            mul(u.data(), q.data(), k, n, k);
+            if (add_n(t, t, u.data(), 2*k) != 0 || cmp(t + k, n, k) >= 0) {
+                sub_n(r, t + k, n, k);
+            } else {
+                std::copy(t + k, t + 2*k, r);
+            }
+        }
+
+        // a = a + c, n words, return carry
+        inline TWord add_1(TWord * a, std::size_t n, TWord c) {
+            for (std::size_t i = 0; i < n && c != 0; ++i) {
+                a[i] += c;
+                c = a[i] < c;
+            }
+            return c;
+        }
+
+        // a = a - c, n words, return borrow
+        inline TWord sub_1(TWord * a, std::size_t n, TWord c) {
+            for (std::size_t i = 0; i < n && c != 0; ++i) {
+                const TWord x = a[i];
+                a[i] = x - c;
+                c = a[i] > x;
+            }
+            return c;
+        }
+
+        // r = a << s, n words, 0 <= s < 64, return the bits shifted out, r can be a
+        inline TWord lshift(TWord * r, const TWord * a, std::size_t n, int s) {
+            if (s == 0) {
+                std::copy(a, a + n, r);
+                return 0;
+            }
+            TWord c = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                const TWord w = a[i];
+                r[i] = (w << s) | c;
+                c = w >> (64 - s);
+            }
+            return c;
+        }
+
+        // r = a >> s, n words, 0 <= s < 64, r can be a
+        inline void rshift(TWord * r, const TWord * a, std::size_t n, int s) {
+            for (std::size_t i = 0; i < n; ++i) {
+                r[i] = s == 0 ? a[i] : (a[i] >> s) | (i + 1 < n ? a[i + 1] << (64 - s) : 0);
+            }
+        }
+
+        // words of the divisor from which divrem_long is faster than divrem
+        inline std::size_t div_threshold() { return 2*kernels().nttThreshold; }
+
+        // quotients and blocks of divrem_long shorter than this are computed with divrem
+        constexpr std::size_t kDivBlock = 64;
+
+        inline bool div_long(std::size_t na, std::size_t nm) {
+            return nm >= div_threshold() && na >= nm + kDivBlock;
+        }
+
+        // x = floor(B^(2n)/d) - c with a small c >= 0, B = 2^64, d has n words with the top bit set, x has n + 1 words
+        // Newton's iteration x' = x + x*(B^(2n) - d*x)/B^(2n) is started from the reciprocal of the top half of d
+        // and doubles its precision. Without rounding x' is never above B^(2n)/d, and all roundings make x' smaller
+        inline void inv(TWord * x, const TWord * d, std::size_t n) {
+            if (n < kernels().nttThreshold) {
+                std::vector<TWord> a(2*n + 2, 0), q(n + 2), r(n), t(n);
+                a[2*n] = 1;
+                divrem(q.data(), r.data(), a.data(), 2*n + 1, d, n, t.data());
+                std::copy(q.begin(), q.begin() + n + 1, x);
+                return;
+            }
+
+            // x = xh*B^(n - h), with one word more than half of the precision, so that the error of xh squared by
+            // the iteration stays below one unit
+            const std::size_t h = n/2 + 1;
+            TWord * xh = x + n - h;
+            std::fill(x, xh, 0);
+            inv(xh, d + n - h, h);
+
+            // e = |B^(2n) - d*x|
+            std::vector<TWord> e(2*n + 1, 0);
+            mul(e.data() + n - h, d, n, xh, h + 1);
+            const bool over = e[2*n] != 0;
+            if (over) {
+                --e[2*n];
+            } else {
+                for (std::size_t i = 0; i < 2*n; ++i) e[i] = ~e[i];
+                add_1(e.data(), 2*n, 1);
+            }
+
+            // x*e/B^(2n) = xh*(e/B^(n - 1))/B^(h + 1), the low words of e change it by less than 1
+            const TWord * et = e.data() + n - 1;
+            const std::size_t ne = size(et, n + 2);
+            std::vector<TWord> f(h + 1 + ne + 1, 0);
+            if (ne > 0) mul(f.data(), xh, h + 1, et, ne);
+            const TWord * c = f.data() + h + 1;
+            const std::size_t nc = size(c, ne + 1);
+            if (over) {
+                sub_1(x + nc, n + 1 - nc, sub_n(x, x, c, nc));
+                sub_1(x, n + 1, 2);
+            } else {
+                add_1(x + nc, n + 1 - nc, add_n(x, x, c, nc));
+            }
+        }
+
+        // q = a/m, r = a mod m for long m, q can be nullptr
+        // a has na >= nm words, m has nm words with m[nm - 1] != 0, q has na - nm + 1 words, r has nm words
+        // Barrett: after the shift that sets the top bit of m, a is reduced from the top in blocks of up to 2*nm
+        // words. The quotient of a block is estimated from its top words and the reciprocal of m and is a few units
+        // too small at most, so a block costs two products instead of nm^2 word operations. Short blocks use divrem
+        inline void divrem_long(TWord * q, TWord * r, const TWord * a, std::size_t na, const TWord * m, std::size_t nm) {
+            const std::size_t n = nm;
+            const int s = __builtin_clzll(m[n - 1]);
+
+            std::vector<TWord> d(n), u(na + 1);
+            lshift(d.data(), m, n, s);
+            u[na] = lshift(u.data(), a, na, s);
+            const std::size_t nu = size(u.data(), na + 1);
+            if (q) std::fill(q, q + na - n + 1, 0);
+            if (nu < n) {
+                std::copy(a, a + n, r);
+                return;
+            }
+
+            // a quotient of k < n/2 words is the quotient of the top 2k words of u by the top k + 1 words of d,
+            // or at most 2 less
+            const std::size_t k = nu - n + 1;
+            if (2*k <= n) {
+                const std::size_t sh = n - k - 1;
+                const std::size_t nt = nu - sh;
+                std::vector<TWord> qt(k + 1, 0), rt(k + 1), ut(nt + 1, 0), tt(k + 1);
+                std::copy(u.begin() + sh, u.begin() + nu, ut.begin());
+                if (div_long(nt, k + 1)) {
+                    divrem_long(qt.data(), rt.data(), ut.data(), nt, d.data() + sh, k + 1);
+                } else {
+                    divrem(qt.data(), rt.data(), ut.data(), nt, d.data() + sh, k + 1, tt.data());
+                }
+
+                // u - qt*d >= 0
+                std::vector<TWord> p(n + k + 1, 0), v(n + k + 1, 0);
+                std::copy(u.begin(), u.begin() + nu, v.begin());
+                const std::size_t nq = size(qt.data(), k);
+                if (nq > 0) mul(p.data(), d.data(), n, qt.data(), nq);
+                while (cmp(p.data(), v.data(), n + k + 1) > 0) {
+                    sub_1(qt.data(), k, 1);
+                    sub_1(p.data() + n, k + 1, sub_n(p.data(), p.data(), d.data(), n));
+                }
+                sub_n(v.data(), v.data(), p.data(), n + k + 1);
+
+                rshift(r, v.data(), n, s);
+                if (q) std::copy(qt.begin(), qt.begin() + std::min(k, na - n + 1), q);
+                return;
+            }
+
+            std::vector<TWord> x(n + 1);
+            inv(x.data(), d.data(), n);
+
+            // blk = blk mod d, blk < B^(2n) has 2n + 1 words, the quotient goes to qb, n + 1 words
+            std::vector<TWord> t(2*n + 2), p(2*n + 1), qb(n + 1);
+            auto reduce = [&](TWord * blk) {
+                mul(t.data(), blk + n - 1, n + 1, x.data(), n + 1);
+                std::copy(t.begin() + n + 1, t.end(), qb.begin());
+                mul(p.data(), qb.data(), n + 1, d.data(), n);
+                sub_n(blk, blk, p.data(), 2*n + 1);
+                while (blk[n] != 0 || cmp(blk, d.data(), n) >= 0) {
+                    blk[n] -= sub_n(blk, blk, d.data(), n);
+                    add_1(qb.data(), n + 1, 1);
+                }
+            };
+
+            // quotient words of the shifted a, the top block can produce n + 1 of them
+            std::vector<TWord> qq(nu + 2, 0), blk(2*n + 1, 0), qs(n + 1), rs(n), ts(n);
+
+            std::size_t pos = nu - std::min(nu, 2*n);
+            std::copy(u.begin() + pos, u.begin() + nu, blk.begin());
+            reduce(blk.data());
+            std::copy(qb.begin(), qb.end(), qq.begin() + pos);
+
+            while (pos > 0) {
+                const std::size_t len = std::min(n, pos);
+                pos -= len;
+
+                // blk = rem*B^len + next len words < d*B^len
+                std::copy_backward(blk.begin(), blk.begin() + n, blk.begin() + len + n);
+                std::copy(u.begin() + pos, u.begin() + pos + len, blk.begin());
+                std::fill(blk.begin() + len + n, blk.end(), 0);
+
+                if (len < kDivBlock) {
+                    divrem(qs.data(), rs.data(), blk.data(), len + n, d.data(), n, ts.data());
+                    std::copy(rs.begin(), rs.end(), blk.begin());
+                    std::fill(blk.begin() + n, blk.end(), 0);
+                    std::copy(qs.begin(), qs.begin() + len, qq.begin() + pos);
+                } else {
+                    reduce(blk.data());
+                    std::copy(qb.begin(), qb.begin() + len, qq.begin() + pos);
+                }
+            }
+
+            rshift(r, blk.data(), n, s);
+            if (q) std::copy(qq.begin(), qq.begin() + std::min(nu + 2, na - n + 1), q);
+        }
+    }
+#endif
+
+    // p = b * a
+    // product scanning (Comba): the digit products of each column are summed in a wide accumulator and every
+    // digit of p is written once. Leading zero digits of a and b are skipped
+    template<std::size_t Size>
+        void mul(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b, TNumTmpl<Size> & p) {
+#ifdef GGINT_WORDS
+            constexpr std::size_t F = mpn::fixed_words(Size);
+            if (F > 0) {
+                using TFixed = mpn::TFixed<F>;
+                std::array<TWord, F> aw, bw, pw;
+                TFixed::load(aw.data(), a.data());
+                if (&a == &b) {
+                    TFixed::sqrlo(pw.data(), aw.data());
+                } else {
+                    TFixed::load(bw.data(), b.data());
+                    TFixed::mullo(pw.data(), aw.data(), bw.data());
+                }
+                TFixed::store(p.data(), pw.data());
+                return;
+            }
+
+            if (Size % kWordDigits == 0) {
+                constexpr std::size_t W = Size/kWordDigits;
+                std::array<TWord, W> aw, bw;
+                std::array<TWord, 2*W> pw;
+                std::memcpy(aw.data(), a.data(), W*sizeof(TWord));
+                std::memcpy(bw.data(), b.data(), W*sizeof(TWord));
+
+                const std::size_t na = mpn::size(aw.data(), W);
+                const std::size_t nb = mpn::size(bw.data(), W);
+                if (na == 0 || nb == 0) {
+                    zero(p);
+                    return;
+                }
+
+                if (&a == &b) {
+                    mpn::sqr(pw.data(), aw.data(), na);
+                } else {
+                    mpn::mul(pw.data(), aw.data(), na, bw.data(), nb);
+                }
+                if (na + nb < W) {
+                    std::fill(pw.begin() + na + nb, pw.begin() + W, 0);
+                }
+                std::memcpy(p.data(), pw.data(), W*sizeof(TWord));
+                return;
+            }
+#endif
+
+            const std::size_t na = ndigits(a);
+            const std::size_t nb = ndigits(b);
+            const std::size_t nc = std::min(Size, na + nb);
+
+            if (std::min(na, nb) >= ntt::kMulThreshold && ntt::mul(p.data(), Size, a.data(), na, b.data(), nb)) {
+                return;
+            }
+
+            TAccum acc = 0;
+            for (std::size_t k = 0; k < nc; ++k) {
+                const std::size_t i0 = k < nb ? 0 : k - nb + 1;
+                const std::size_t i1 = std::min(k + 1, na);
+                for (auto i = i0; i < i1; ++i) {
+                    acc += (TOverflow) a[i]*b[k - i];
+                }
+                p[k] = acc % kDigitMax;
+                acc /= kDigitMax;
+            }
+
+            for (auto k = nc; k < Size; ++k) {
+                p[k] = 0;
+            }
+        }
+
+    // p = p + a*b*kDigitMax^sh, using the first n digits of b
+    // return the carry out of the top digit of p
+    template<std::size_t Size>
+        TOverflow addmul_1(TDigit a, const TNumTmpl<Size> & b, TNumTmpl<Size> & p, std::size_t sh = 0, std::size_t n = Size) {
+            n = std::min(n, Size - std::min(Size, sh));
+
+            TOverflow r = 0;
+            std::size_t i = 0;
+            for (; i < n; ++i) {
+                TOverflow x = a;
+                x *= b[i];
+                x += p[i + sh];
+                x += r;
+                p[i + sh] = x % kDigitMax;
+                r = x / kDigitMax;
+            }
+            for (i += sh; r != 0 && i < Size; ++i) {
+                TOverflow x = p[i];
+                x += r;
+                p[i] = x % kDigitMax;
+                r = x / kDigitMax;
+            }
+
+            return r;
+        }
+
+    // p = p - a*b*kDigitMax^sh, using the first n digits of b
+    // return the borrow out of the top digit of p
+    template<std::size_t Size>
+        TOverflow submul_1(TDigit a, const TNumTmpl<Size> & b, TNumTmpl<Size> & p, std::size_t sh = 0, std::size_t n = Size) {
+            n = std::min(n, Size - std::min(Size, sh));
+
+            TOverflow r = 0;
+            std::size_t i = 0;
+            for (; i < n; ++i) {
+                TOverflow x = a;
+                x *= b[i];
+                x += r;
+                TDigit lo = x % kDigitMax;
+                r = x / kDigitMax;
+                if (p[i + sh] < lo) ++r;
+                p[i + sh] -= lo;
+            }
+            for (i += sh; r != 0 && i < Size; ++i) {
+                TDigit lo = r % kDigitMax;
+                r /= kDigitMax;
+                if (p[i] < lo) ++r;
+                p[i] -= lo;
+            }
+
+            return r;
+        }
+
+    // a == b
+    template<std::size_t Size>
+        bool equal(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b) {
+            for (auto i = 0; i < Size; ++i) {
+                if (a[i] != b[i]) return false;
+            }
+            return true;
+        }
+
+    // a < b
+    template<std::size_t Size>
+        bool less(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b) {
+            for (auto i = Size - 1; ; --i) {
+                if (a[i] < b[i]) return true;
+                if (a[i] > b[i]) return false;
+                if (i == 0) break;
+            }
+            return false;
+        }
+
+    // a <= b
+    template<std::size_t Size>
+        bool less_or_equal(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b) {
+            for (auto i = Size - 1; ; --i) {
+                if (a[i] < b[i]) return true;
+                if (a[i] > b[i]) return false;
+                if (i == 0) break;
+            }
+            return true;
+        }
+
+    // a == 0
+    template<std::size_t Size>
+        bool is_zero(const TNumTmpl<Size> & a) {
+            for (auto i = 0; i < Size; ++i) {
+                if (a[i] != 0) return false;
+            }
+            return true;
+        }
+
+    // number of significant bits in a
+    template<std::size_t Size>
+        std::size_t nbits(const TNumTmpl<Size> & a) {
+            for (auto i = Size - 1; ; --i) {
+                if (a[i] != 0) {
+                    std::size_t n = i*kDigitBits;
+                    for (TDigit d = a[i]; d != 0; d >>= 1) ++n;
+                    return n;
+                }
+                if (i == 0) break;
+            }
+            return 0;
+        }
+
+    // (a >> i) & 1
+    template<std::size_t Size>
+        bool bit(const TNumTmpl<Size> & a, std::size_t i) {
+            return (a[i/kDigitBits] >> (i%kDigitBits)) & 1;
+        }
+
+    // a & 1 == 0
+    template<std::size_t Size>
+        bool is_even(const TNumTmpl<Size> & a) {
+            return (a[0] & 1) == 0;
+        }
+
+    // a & 1 == 1
+    template<std::size_t Size>
+        bool is_odd(const TNumTmpl<Size> & a) {
+            return (a[0] & 1) == 1;
+        }
+
+    // r = r - k*a, return k = floor(r/a), requires r < kDigitMax*a
+    // m is the index of the top digit of a. The quotient digit is estimated from the top digits of r and a, it is
+    // off by at most 2 and gets corrected with additions or subtractions of a
+    template<std::size_t Size>
+        TDigit divrem_step(const TNumTmpl<Size> & a, std::size_t m, TNumTmpl<Size> & r) {
+            const std::size_t n = std::min(Size, m + 2);
+
+            TAccum rt = r[m];
+            TAccum at = a[m];
+            if (m + 1 < Size) rt += r[m + 1]*kDigitMax;
+            rt *= kDigitMax;
+            at *= kDigitMax;
+            if (m > 0) {
+                rt += r[m - 1];
+                at += a[m - 1];
+            }
+
+            TOverflow k = std::min<TAccum>(kDigitMax - 1, rt/at);
+            if (k > 0) {
+                auto bw = submul_1((TDigit) k, a, r, 0, m + 1);
+                while (bw != 0) {
+                    --k;
+                    bw -= addmul_1(1, a, r, 0, m + 1);
+                }
+            }
+
+            while (true) {
+                bool ge = true;
+                for (auto i = n; i > 0; --i) {
+                    if (r[i - 1] != a[i - 1]) {
+                        ge = r[i - 1] > a[i - 1];
+                        break;
+                    }
+                }
+                if (ge == false) break;
+
+                submul_1(1, a, r, 0, m + 1);
+                ++k;
+            }
+
+            return k;
+        }
+
+#ifdef GGINT_WORDS
+    // q = b/a, r = b % a with the word level division, q can be nullptr
+    // b has nb words, return false if a is zero
+    template<std::size_t Size>
+        bool divrem_words(const TNumTmpl<Size> & a, const TWord * b, std::size_t nb, TNumTmpl<Size> * q, TNumTmpl<Size> & r) {
+            constexpr std::size_t W = Size/kWordDigits;
+            std::array<TWord, W> aw, t;
+            std::memcpy(aw.data(), a.data(), W*sizeof(TWord));
+            const std::size_t na = mpn::size(aw.data(), W);
+            if (na == 0) return false;
+
+            nb = mpn::size(b, nb);
+            std::array<TWord, 2*W + 1> u, qw, rw;
+            std::copy(b, b + nb, u.begin());
+            std::fill(qw.begin(), qw.end(), 0);
+            std::fill(rw.begin(), rw.end(), 0);
+            if (nb < na) {
+                std::copy(b, b + nb, rw.begin());
+            } else if (mpn::div_long(nb, na)) {
+                mpn::divrem_long(q ? qw.data() : nullptr, rw.data(), u.data(), nb, aw.data(), na);
+            } else {
+                mpn::divrem(q ? qw.data() : nullptr, rw.data(), u.data(), nb, aw.data(), na, t.data());
+            }
+
+            if (q) std::memcpy(q->data(), qw.data(), W*sizeof(TWord));
+            std::memcpy(r.data(), rw.data(), W*sizeof(TWord));
+
+            return true;
+        }
+#endif
+
+    // b / a = q, b % a = r
+    template<std::size_t Size>
+        void div(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b, TNumTmpl<Size> & q, TNumTmpl<Size> & r) {
+#ifdef GGINT_WORDS
+            if (Size % kWordDigits == 0) {
+                std::array<TWord, Size/kWordDigits> bw;
+                std::memcpy(bw.data(), b.data(), Size);
+                if (divrem_words(a, bw.data(), bw.size(), &q, r)) return;
+            }
+#endif
+            zero(q);
+            zero(r);
+
+            const std::size_t m = ndigits(a) - 1;
+            for (auto i = ndigits(b); i > 0; --i) {
+                for (auto j = std::min(m + 1, Size - 1); j > 0; --j) {
+                    r[j] = r[j - 1];
+                }
+                r[0] = b[i - 1];
+                q[i - 1] = divrem_step(a, m, r);
+            }
+        }
+
+    // b % a = r, r can be b
+    template<std::size_t Size>
+        void mod(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b, TNumTmpl<Size> & r) {
+#ifdef GGINT_WORDS
+            if (Size % kWordDigits == 0) {
+                std::array<TWord, Size/kWordDigits> bw;
+                std::memcpy(bw.data(), b.data(), Size);
+                if (divrem_words(a, bw.data(), bw.size(), (TNumTmpl<Size> *) nullptr, r)) return;
+            }
+#endif
+            if (less(b, a)) {
+                r = b;
+                return;
+            }
+
+            if (&r == &b) {
+                const auto t = b;
+                mod(a, t, r);
+                return;
+            }
+
+            zero(r);
+
+            const std::size_t m = ndigits(a) - 1;
+            for (auto i = ndigits(b); i > 0; --i) {
+                for (auto j = std::min(m + 1, Size - 1); j > 0; --j) {
+                    r[j] = r[j - 1];
+                }
+                r[0] = b[i - 1];
+                divrem_step(a, m, r);
+            }
+        }
+
+    // b % a = r
+    template<std::size_t Size>
+        void mod(std::size_t a, const TNumTmpl<Size> & b, std::size_t & r) {
+            r = 0;
+            auto i = ndigits(b);
+
+            // 4 digits per division while r*kDigitMax^4 fits in 64 bits
+            if (a <= 0xffffffffull) {
+                for (; i >= 4; i -= 4) {
+                    uint64_t x = r;
+                    for (std::size_t k = 1; k <= 4; ++k) x = x*kDigitMax + b[i - k];
+                    r = x % a;
+                }
+            }
+
+            for (; i > 0; --i) {
+                r = (r*kDigitMax + b[i - 1]) % a;
+            }
+        }
+
+    // r = a*b mod m, r can be a, b or m
+    // the full product of 2*Size digits is reduced, so unlike mul + mod this works for any m
+    template<std::size_t Size>
+        void mul_mod(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b, const TNumTmpl<Size> & m, TNumTmpl<Size> & r) {
+#ifdef GGINT_WORDS
+            if (Size % kWordDigits == 0) {
+                constexpr std::size_t W = Size/kWordDigits;
+                std::array<TWord, W> aw, bw;
+                std::array<TWord, 2*W> pw;
+                std::memcpy(aw.data(), a.data(), W*sizeof(TWord));
+                std::memcpy(bw.data(), b.data(), W*sizeof(TWord));
+
+                constexpr std::size_t F = mpn::fixed_words(Size);
+                if (F > 0) {
+                    if (&a == &b) {
+                        mpn::TFixed<F>::sqr(pw.data(), aw.data());
+                    } else {
+                        mpn::TFixed<F>::mul(pw.data(), aw.data(), bw.data());
+                    }
+                } else {
+                    const std::size_t na = mpn::size(aw.data(), W);
+                    const std::size_t nb = mpn::size(bw.data(), W);
+                    std::fill(pw.begin(), pw.end(), 0);
+                    if (na > 0 && nb > 0) {
+                        if (&a == &b) {
+                            mpn::sqr(pw.data(), aw.data(), na);
+                        } else {
+                            mpn::mul(pw.data(), aw.data(), na, bw.data(), nb);
+                        }
+                    }
+                }
+
+                if (divrem_words(m, pw.data(), pw.size(), (TNumTmpl<Size> *) nullptr, r)) return;
+                zero(r);
+                return;
+            }
+#endif
+            TNumTmpl<2*Size> aa, bb, mm, t;
+            zero(aa);
+            zero(bb);
+            zero(mm);
+            std::copy(a.begin(), a.end(), aa.begin());
+            std::copy(b.begin(), b.end(), bb.begin());
+            std::copy(m.begin(), m.end(), mm.begin());
+            ggint::mul(aa, &a == &b ? aa : bb, t);
+            ggint::mod(mm, t, aa);
+            std::copy(aa.begin(), aa.begin() + Size, r.begin());
+        }
+
+    // r = a*a mod m, r can be a or m
+    template<std::size_t Size>
+        void sqr_mod(const TNumTmpl<Size> & a, const TNumTmpl<Size> & m, TNumTmpl<Size> & r) {
+            mul_mod(a, a, m, r);
+        }
+
+    // r = a + b*c, r can be a, b or c
+    template<std::size_t Size>
+        void add_mul(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b, const TNumTmpl<Size> & c, TNumTmpl<Size> & r) {
+#ifdef GGINT_WORDS
+            constexpr std::size_t F = mpn::fixed_words(Size);
+            if (F > 0) {
+                using TFixed = mpn::TFixed<F>;
+                std::array<TWord, F> aw, bw, cw, pw;
+                TFixed::load(aw.data(), a.data());
+                TFixed::load(bw.data(), b.data());
+                TFixed::load(cw.data(), c.data());
+                TFixed::mullo(pw.data(), bw.data(), cw.data());
+                TFixed::add_n(pw.data(), pw.data(), aw.data());
+                TFixed::store(r.data(), pw.data());
+                return;
+            }
+#endif
+            TNumTmpl<Size> t;
+            ggint::mul(b, c, t);
+            add(a, t);
+            r = t;
+        }
+
+    // r = gcd(a, b), r can be a or b
+    template<std::size_t Size>
+        void gcd(const TNumTmpl<Size> & a, const TNumTmpl<Size> & b, TNumTmpl<Size> & r) {
+            if (is_zero(a) || is_zero(b)) {
+                r = is_zero(a) ? b : a;
+                return;
+            }
+
+#ifdef GGINT_WORDS
+            if (Size % kWordDigits == 0) {
+                constexpr std::size_t W = Size/kWordDigits;
+                std::array<TWord, W> u, v, w;
+                std::memcpy(u.data(), a.data(), Size);
+                std::memcpy(v.data(), b.data(), Size);
+                mpn::gcd(w.data(), u.data(), v.data(), W);
+                std::memcpy(r.data(), w.data(), Size);
+                return;
+            }
+#endif
+            // binary gcd: both numbers are kept odd and the larger one is replaced with the difference
+            TNumTmpl<Size> u = a, v = b;
+            auto strip = [](TNumTmpl<Size> & x) {
+                std::size_t s = 0;
+                while (bit(x, s) == false) ++s;
+                shbr(x, s);
+                return s;
+            };
+
+            const std::size_t sh = std::min(strip(u), strip(v));
+            while (equal(u, v) == false) {
+                if (less(v, u)) std::swap(u, v);
+                sub(u, v);
+                strip(v);
+            }
+            shbl(u, sh);
+            r = u;
+        }
+
+    // generate random number a
+    template<std::size_t Size>
+        void rand(TNumTmpl<Size> & a) {
+            for (auto & d : a) {
+                d = std::rand() % kDigitMax;
+            }
+        }
+
+    // generate random number a < b
+    template<std::size_t Size>
+        void rand(TNumTmpl<Size> & a, const TNumTmpl<Size> b) {
+            for (auto & d : a) {
+                d = std::rand() % kDigitMax;
+            }
+
+            auto t = a;
+            TNumTmpl<Size> q;
+            div(b, t, q, a);
+        }
+
+    // Reduction contexts
+    // The modular exponentiations are written against a context for a fixed modulus n which keeps the numbers in
+    // its own internal form:
+    //
+    //   init(n)        - prepare for modulus n, return false if the context cannot handle n
+    //   to(a, x)       - x = a mod n in internal form
+    //   from(x, a)     - a = x converted back
+    //   one(x)         - x = 1 in internal form
+    //   mul(x, y, z)   - z = x*y mod n, z can be x or y
+    //   sqr(x, z)      - z = x*x mod n, z can be x
+    //   dbl(x)         - x = 2*x mod n
+    //   add(x, y, z)   - z = x + y mod n, z can be x or y
+    //   sub(x, y, z)   - z = x - y mod n, z can be x or y
+    //
+
+    // plain numbers, products reduced with mul_mod, any n of up to Size digits
+    template<std::size_t Size>
+        struct TModular {
+            using TElem = TNumTmpl<Size>;
+
+            TNumTmpl<Size> n;
+
+            bool init(const TNumTmpl<Size> & nn) {
+                n = nn;
+                return is_zero(n) == false;
+            }
+
+            void to(const TNumTmpl<Size> & a, TElem & x) const { ggint::mod(n, a, x); }
+            void from(const TElem & x, TNumTmpl<Size> & a) const { a = x; }
+
+            void one(TElem & x) const {
+                TElem t;
+                ggint::one(t);
+                ggint::mod(n, t, x);
+            }
+
+            void mul(const TElem & x, const TElem & y, TElem & z) const { ggint::mul_mod(x, y, n, z); }
+            void sqr(const TElem & x, TElem & z) const { ggint::sqr_mod(x, n, z); }
+
+            // the bit shifted out is kept, n can have the top bit set
+            void dbl(TElem & x) const {
+                const bool c = x[Size - 1] >> (kDigitBits - 1);
+                shbl(x, 1);
+                if (c || less_or_equal(n, x)) {
+                    ggint::sub(n, x);
+                }
+            }
+
+            // the sum wrapped around if it is below y
+            void add(const TElem & x, const TElem & y, TElem & z) const {
+                TElem t = x;
+                ggint::add(y, t);
+                if (less(t, y) || less_or_equal(n, t)) {
+                    ggint::sub(n, t);
+                }
+                z = t;
+            }
+
+            void sub(const TElem & x, const TElem & y, TElem & z) const {
+                TElem t = x;
+                if (less(x, y)) {
+                    ggint::add(n, t);
+                }
+                ggint::sub(y, t);
+                z = t;
+            }
+        };
+
+#ifdef GGINT_WORDS
+    // Montgomery form x = a*R mod n, R = 2^(64k) where k is the number of words of the odd modulus n
+    // The reduction of a product is done with k word multiply-accumulate passes instead of a division.
+    // Requires 2k <= W, init forms R and (R mod n)^2 as plain numbers of Size digits
+    template<std::size_t Size>
+        struct TMontgomery {
+            static constexpr std::size_t W = Size/kWordDigits;
+
+            // moduli of up to kFixed words use the unrolled kernels, for longer ones the assembly kernels are faster
+            static constexpr std::size_t kFixed = 4;
+
+            using TElem = std::array<TWord, W>;
+
+            std::size_t k = 0;
+            TWord ninv = 0; // -n^-1 mod 2^64
+            TElem n;
+            TElem r1;       // R mod n
+            TElem r2;       // R^2 mod n
+
+            std::vector<TWord> nprime; // -n^-1 mod R, for redc_n with long moduli
+
+            bool init(const TNumTmpl<Size> & nn) {
+                if (Size % kWordDigits != 0 || is_odd(nn) == false) return false;
+
+                std::memcpy(n.data(), nn.data(), W*sizeof(TWord));
+                k = mpn::size(n.data(), W);
+                if (2*k > W) return false;
+
+                // Newton iteration, each step doubles the number of correct low bits
+                TWord inv = n[0];
+                for (int i = 0; i < 5; ++i) {
+                    inv *= 2 - n[0]*inv;
+                }
+                ninv = -inv;
+
+                const std::size_t nb = nbits(nn);
+                if (k <= kFixed && nb > 1) {
+                    // for short n the divisions cost more than the exponentiation, instead R is reached by doubling
+                    // 2^(nb - 1) < n and R^2 = 2^(64k)*R by doubling and squaring 2^j*R in Montgomery form
+                    std::fill(r1.begin(), r1.end(), 0);
+                    r1[(nb - 1)/64] = (TWord) 1 << ((nb - 1) % 64);
+                    for (auto i = nb - 1; i < 64*k; ++i) dbl(r1);
+
+                    std::size_t j = 64*k, nsqr = 0;
+                    for (; j % 2 == 0; j /= 2) ++nsqr;
+                    r2 = r1;
+                    for (std::size_t i = 0; i < j; ++i) dbl(r2);
+                    for (std::size_t i = 0; i < nsqr; ++i) sqr(r2, r2);
+                } else {
+                    TNumTmpl<Size> r, t;
+                    ggint::one(r);
+                    shbl(r, 64*k);
+                    ggint::mod(nn, r, t);
+                    std::memcpy(r1.data(), t.data(), W*sizeof(TWord));
+                    ggint::mul(t, t, r);
+                    ggint::mod(nn, r, t);
+                    std::memcpy(r2.data(), t.data(), W*sizeof(TWord));
+                }
+
+                // Newton iteration x = x*(2 - n*x) mod R, starting from the 64-bit inverse
+                nprime.clear();
+                if (k >= mpn::kParallelThreshold) {
+                    std::vector<TWord> x(k, 0), y(2*k), z(2*k);
+                    x[0] = inv;
+                    for (std::size_t bits = 64; bits < 64*k; bits *= 2) {
+                        mpn::mul(y.data(), n.data(), k, x.data(), k);
+                        TWord c = 3;
+                        for (std::size_t i = 0; i < k; ++i) {
+                            y[i] = ~y[i] + c;
+                            c = y[i] < c;
+                        }
+                        mpn::mul(z.data(), x.data(), k, y.data(), k);
+                        std::copy(z.begin(), z.begin() + k, x.begin());
+                    }
+
+                    nprime.resize(k);
+                    TWord c = 1;
+                    for (std::size_t i = 0; i < k; ++i) {
+                        nprime[i] = ~x[i] + c;
+                        c = nprime[i] < c;
+                    }
+                }
+
+                return true;
+            }
+
+            // z = t*R^-1 mod n, t is overwritten
+            void reduce(TWord * t, TElem & z) const {
+                if (nprime.empty() == false && mpn::parallel(k)) {
+                    mpn::redc_n(z.data(), t, n.data(), k, nprime.data());
+                } else {
+                    mpn::redc_1(z.data(), t, n.data(), k, ninv);
+                }
+            }
+
+            void to(const TNumTmpl<Size> & a, TElem & x) const {
+                TNumTmpl<Size> t, nn;
+                zero(nn);
+                std::memcpy(nn.data(), n.data(), k*sizeof(TWord));
+                ggint::mod(nn, a, t);
+                std::memcpy(x.data(), t.data(), W*sizeof(TWord));
+                mul(x, r2, x);
+            }
+
+            void from(const TElem & x, TNumTmpl<Size> & a) const {
+                std::array<TWord, 2*W> t;
+                std::fill(t.begin(), t.end(), 0);
+                std::copy(x.begin(), x.begin() + k, t.begin());
+
+                TElem y;
+                std::fill(y.begin(), y.end(), 0);
+                mpn::redc_1(y.data(), t.data(), n.data(), k, ninv);
+                std::memcpy(a.data(), y.data(), W*sizeof(TWord));
+            }
+
+            void one(TElem & x) const { x = r1; }
+
+            // unrolled kernels for k <= kFixed words, only the sizes that fit in TElem are instantiated
+            template <std::size_t N>
+                using TFixed = mpn::TFixed<2*N <= W ? N : 1>;
+
+            void mul(const TElem & x, const TElem & y, TElem & z) const {
+                switch (k) {
+                    case 1: TFixed<1>::mont_mul(z.data(), x.data(), y.data(), n.data(), ninv); return;
+                    case 2: TFixed<2>::mont_mul(z.data(), x.data(), y.data(), n.data(), ninv); return;
+                    case 3: TFixed<3>::mont_mul(z.data(), x.data(), y.data(), n.data(), ninv); return;
+                    case 4: TFixed<4>::mont_mul(z.data(), x.data(), y.data(), n.data(), ninv); return;
+                }
+
+                std::array<TWord, 2*W> t;
+                mpn::mul(t.data(), x.data(), k, y.data(), k);
+                reduce(t.data(), z);
+            }
+
+            void sqr(const TElem & x, TElem & z) const {
+                switch (k) {
+                    case 1: TFixed<1>::mont_sqr(z.data(), x.data(), n.data(), ninv); return;
+                    case 2: TFixed<2>::mont_sqr(z.data(), x.data(), n.data(), ninv); return;
+                    case 3: TFixed<3>::mont_sqr(z.data(), x.data(), n.data(), ninv); return;
+                    case 4: TFixed<4>::mont_sqr(z.data(), x.data(), n.data(), ninv); return;
+                }
+
+                std::array<TWord, 2*W> t;
+                mpn::sqr(t.data(), x.data(), k);
+                reduce(t.data(), z);
+            }
+
+            void dbl(TElem & x) const {
+                switch (k) {
+                    case 1: TFixed<1>::add_mod(x.data(), x.data(), x.data(), n.data()); return;
+                    case 2: TFixed<2>::add_mod(x.data(), x.data(), x.data(), n.data()); return;
+                    case 3: TFixed<3>::add_mod(x.data(), x.data(), x.data(), n.data()); return;
+                    case 4: TFixed<4>::add_mod(x.data(), x.data(), x.data(), n.data()); return;
+                }
+
+                TWord c = 0;
+                for (std::size_t i = 0; i < k; ++i) {
+                    TWord d = x[i];
+                    x[i] = (d << 1) | c;
+                    c = d >> 63;
+                }
+                if (c != 0 || mpn::cmp(x.data(), n.data(), k) >= 0) {
+                    mpn::sub_n(x.data(), x.data(), n.data(), k);
+                }
+            }
+
+            void add(const TElem & x, const TElem & y, TElem & z) const {
+                const TWord c = mpn::add_n(z.data(), x.data(), y.data(), k);
+                if (c != 0 || mpn::cmp(z.data(), n.data(), k) >= 0) {
+                    mpn::sub_n(z.data(), z.data(), n.data(), k);
+                }
+            }
+
+            void sub(const TElem & x, const TElem & y, TElem & z) const {
+                if (mpn::sub_n(z.data(), x.data(), y.data(), k) != 0) {
+                    mpn::add_n(z.data(), z.data(), n.data(), k);
+                }
+            }
+        };
+#endif
+
+    // Special form moduli, reduced with shifts and one multiplication or division by a small number:
+    //
+    //   pseudo-Mersenne n = 2^k - c (Mersenne: c = 1)   t = hi*2^k + lo = hi*c + lo mod n, folded until t < 2^k
+    //   Proth           n = h*2^k + 1                   t = hi*2^k + lo = (hi % h)*2^k + lo - hi/h mod n
+    //
+    // The reduction is linear in the size of n instead of quadratic. init detects the form, init_pseudo_mersenne and
+    // init_proth construct n from its parameters. Requires 2*nbits(n) <= kDigitBits*Size, the products are formed in
+    // Size digits before they are reduced
+    template<std::size_t Size>
+        struct TSpecial {
+            using TElem = TNumTmpl<Size>;
+
+            // largest c or h
+            static constexpr std::size_t kSmallBits = 48;
+
+            // smallest n for which pow_mod prefers this context, Montgomery with the word kernels is faster below
+#ifdef GGINT_WORDS
+            static constexpr std::size_t kMinBits = 2048;
+#else
+            static constexpr std::size_t kMinBits = 0;
+#endif
+
+            enum EForm {
+                kNone,
+                kPseudoMersenne,
+                kProth,
+            };
+
+            EForm form = kNone;
+            std::size_t k = 0;
+            TNumTmpl<Size> n;
+            TNumTmpl<Size> c;   // c or h
+            TAccum small = 0;   // c or h as a number
+
+            bool init(const TNumTmpl<Size> & nn) {
+                form = kNone;
+
+                const std::size_t nb = nbits(nn);
+                if (nb < 3 || 2*nb > kDigitBits*Size) return false;
+
+                TNumTmpl<Size> t;
+                ggint::one(t);
+                shbl(t, nb);
+                ggint::sub(nn, t);
+                if (2*nbits(t) < nb && nbits(t) <= kSmallBits) {
+                    return init_pseudo_mersenne(nb, t);
+                }
+
+                if (is_even(nn)) return false;
+
+                TNumTmpl<Size> _1;
+                ggint::one(_1);
+                t = nn;
+                ggint::sub(_1, t);
+                std::size_t m = 0;
+                while (bit(t, m) == false) ++m;
+                shbr(t, m);
+                if (nbits(t) < m && nbits(t) <= kSmallBits) {
+                    return init_proth(t, m);
+                }
+
+                return false;
+            }
+
+            // n = 2^kk - cc
+            bool init_pseudo_mersenne(std::size_t kk, const TNumTmpl<Size> & cc) {
+                form = kNone;
+                if (2*kk > kDigitBits*Size || is_zero(cc) || nbits(cc) > kSmallBits || 2*nbits(cc) >= kk) return false;
+
+                ggint::one(n);
+                shbl(n, kk);
+                ggint::sub(cc, n);
+
+                form = kPseudoMersenne;
+                k = kk;
+                c = cc;
+                small = to_small(cc);
+
+                return true;
+            }
+
+            // n = hh*2^kk + 1
+            bool init_proth(const TNumTmpl<Size> & hh, std::size_t kk) {
+                form = kNone;
+                if (is_zero(hh) || nbits(hh) > kSmallBits || nbits(hh) >= kk || 2*(nbits(hh) + kk) > kDigitBits*Size) return false;
+
+                n = hh;
+                shbl(n, kk);
+                ggint::add(1, n);
+
+                form = kProth;
+                k = kk;
+                c = hh;
+                small = to_small(hh);
+
+                return true;
+            }
+
+            // t = t mod n, t < n^2
+            void reduce(TElem & t) const {
+#ifdef GGINT_WORDS
+                if (Size % kWordDigits == 0) {
+                    reduce_words(t);
+                    return;
+                }
+#endif
+                TElem hi, p;
+                if (form == kPseudoMersenne) {
+                    while (nbits(t) > k) {
+                        hi = t;
+                        shbr(hi, k);
+                        low_bits(t);
+                        ggint::mul(hi, c, p);
+                        ggint::add(p, t);
+                    }
+                    if (less_or_equal(n, t)) {
+                        ggint::sub(n, t);
+                    }
+                    return;
+                }
+
+                // q = hi/h exceeds the true quotient by at most 2, so n is added at most twice
+                hi = t;
+                shbr(hi, k);
+                low_bits(t);
+
+                TAccum r = 0;
+                zero(p);
+                for (auto i = ndigits(hi); i > 0; --i) {
+                    r = r*kDigitMax + hi[i - 1];
+                    p[i - 1] = (TDigit) (r/small);
+                    r %= small;
+                }
+
+                set(hi, r);
+                shbl(hi, k);
+                ggint::add(hi, t);
+                while (less(t, p)) {
+                    ggint::add(n, t);
+                }
+                ggint::sub(p, t);
+            }
+
+            void to(const TNumTmpl<Size> & a, TElem & x) const { ggint::mod(n, a, x); }
+            void from(const TElem & x, TNumTmpl<Size> & a) const { a = x; }
+
+            void one(TElem & x) const { ggint::one(x); }
+
+            void mul(const TElem & x, const TElem & y, TElem & z) const {
+                TElem t;
+                ggint::mul(x, y, t);
+                reduce(t);
+                z = t;
+            }
+
+            void sqr(const TElem & x, TElem & z) const { mul(x, x, z); }
+
+            void dbl(TElem & x) const {
+                shbl(x, 1);
+                if (less_or_equal(n, x)) {
+                    ggint::sub(n, x);
+                }
+            }
+
+            void add(const TElem & x, const TElem & y, TElem & z) const {
+                TElem t = x;
+                ggint::add(y, t);
+                if (less_or_equal(n, t)) {
+                    ggint::sub(n, t);
+                }
+                z = t;
+            }
+
+            void sub(const TElem & x, const TElem & y, TElem & z) const {
+                TElem t = x;
+                if (less(x, y)) {
+                    ggint::add(n, t);
+                }
+                ggint::sub(y, t);
+                z = t;
+            }
+
+            private:
+            static TAccum to_small(const TNumTmpl<Size> & a) {
+                TAccum r = 0;
+                for (auto i = ndigits(a); i > 0; --i) {
+                    r = r*kDigitMax + a[i - 1];
+                }
+                return r;
+            }
+
+            // t = t mod 2^k
+            void low_bits(TElem & t) const {
+                const std::size_t i = k/kDigitBits;
+                if (i >= Size) return;
+                t[i] &= (1 << (k % kDigitBits)) - 1;
+                std::fill(t.begin() + i + 1, t.end(), 0);
+            }
+
+#ifdef GGINT_WORDS
+            // the same reduction on 64-bit words
+            void reduce_words(TElem & t) const {
+                constexpr std::size_t W = Size/kWordDigits;
+                std::array<TWord, W> tw, hi, nw;
+                std::memcpy(tw.data(), t.data(), W*sizeof(TWord));
+                std::memcpy(nw.data(), n.data(), W*sizeof(TWord));
+
+                const std::size_t kw = k/64;
+                const std::size_t kb = k%64;
+
+                // hi = t >> k, t = t mod 2^k, return the number of words of hi
+                auto split = [&]() -> std::size_t {
+                    const std::size_t nt = mpn::size(tw.data(), W);
+                    if (nt <= kw) return 0;
+                    const std::size_t nh = nt - kw;
+                    for (std::size_t i = 0; i < nh; ++i) {
+                        hi[i] = tw[kw + i] >> kb;
+                        if (kb > 0 && kw + i + 1 < nt) hi[i] |= tw[kw + i + 1] << (64 - kb);
+                    }
+                    tw[kw] &= kb > 0 ? ((TWord) 1 << kb) - 1 : 0;
+                    std::fill(tw.begin() + kw + 1, tw.begin() + nt, 0);
+                    return mpn::size(hi.data(), nh);
+                };
+
+                // t = t + a*2^(64*i)
+                auto add_word = [&](TWord a, std::size_t i) {
+                    for (; a != 0 && i < W; ++i) {
+                        tw[i] += a;
+                        a = tw[i] < a;
+                    }
+                };
+
+                const std::size_t nn = std::min(W, mpn::size(nw.data(), W) + 1);
+                if (form == kPseudoMersenne) {
+                    for (std::size_t nh = split(); nh > 0; nh = split()) {
+                        add_word(mpn::addmul_1(tw.data(), hi.data(), nh, small), nh);
+                    }
+                    if (mpn::cmp(tw.data(), nw.data(), nn) >= 0) {
+                        mpn::sub_n(tw.data(), tw.data(), nw.data(), nn);
+                    }
+                } else {
+                    const std::size_t nh = split();
+
+                    // q = hi/h, r = hi % h
+                    std::array<TWord, W> q;
+                    std::fill(q.begin(), q.end(), 0);
+                    TWord r = 0;
+                    for (auto i = nh; i > 0; --i) {
+                        const TWide cur = ((TWide) r << 64) | hi[i - 1];
+                        q[i - 1] = (TWord) (cur/small);
+                        r = (TWord) (cur % small);
+                    }
+
+                    add_word(r << kb, kw);
+                    if (kb > 0) add_word(r >> (64 - kb), kw + 1);
+
+                    while (mpn::cmp(tw.data(), q.data(), nn) < 0) {
+                        mpn::add_n(tw.data(), tw.data(), nw.data(), nn);
+                    }
+                    mpn::sub_n(tw.data(), tw.data(), q.data(), nn);
+                }
+
+                std::memcpy(t.data(), tw.data(), W*sizeof(TWord));
+            }
+#endif
+        };
+
+    // r = a[0]^x[0] * a[1]^x[1] * ... * a[k-1]^x[k-1] mod n, n given by the reduction context red
+    // Straus: all bases share the same chain of squarings, each base contributes one
+    // multiplication per window of w exponent bits using a table of its first 2^w powers
+    template<std::size_t Size, typename TRed>
+        void multi_pow_mod_ctx(const TRed & red, const TNumTmpl<Size> * a, const TNumTmpl<Size> * x, std::size_t k, TNumTmpl<Size> & r) {
+            using TElem = typename TRed::TElem;
+
+            std::size_t xbits = 0;
+            for (std::size_t j = 0; j < k; ++j) {
+                xbits = std::max(xbits, nbits(x[j]));
+            }
+
+            // pick the window that minimizes table setup + per-window multiplications
+            std::size_t w = 1;
+            for (std::size_t c = 2; c <= 6; ++c) {
+                if (((std::size_t) 1 << c) + xbits/c < ((std::size_t) 1 << w) + xbits/w) w = c;
+            }
+
+            std::vector<TElem> table(k << w);
+            for (std::size_t j = 0; j < k; ++j) {
+                auto * tj = table.data() + (j << w);
+                red.one(tj[0]);
+                red.to(a[j], tj[1]);
+                for (std::size_t d = 2; d < ((std::size_t) 1 << w); ++d) {
+                    red.mul(tj[d - 1], tj[1], tj[d]);
+                }
+            }
+
+            TElem y;
+            red.one(y);
+            bool is_one = true;
+            for (std::size_t pos = ((xbits + w - 1)/w)*w; pos > 0; ) {
+                pos -= w;
+
+                if (is_one == false) {
+                    for (std::size_t s = 0; s < w; ++s) {
+                        red.sqr(y, y);
+                    }
+                }
+
+                for (std::size_t j = 0; j < k; ++j) {
+                    std::size_t d = 0;
+                    for (std::size_t s = w; s > 0; --s) {
+                        d = (d << 1) | (pos + s - 1 < kDigitBits*Size && bit(x[j], pos + s - 1));
+                    }
+                    if (d == 0) continue;
+
+                    red.mul(y, table[(j << w) + d], y);
+                    is_one = false;
+                }
+            }
+
+            red.from(y, r);
+        }
+
+    // r = a^x mod n, n given by the reduction context red
+    template<std::size_t Size, typename TRed>
+        void pow_mod_ctx(const TRed & red, const TNumTmpl<Size> & a, const TNumTmpl<Size> & x, TNumTmpl<Size> & r) {
+            multi_pow_mod_ctx(red, &a, &x, 1, r);
+        }
+
+    // r = 2^x mod n, n given by the reduction context red
+    // the multiplication by the base is a single bit shift followed by a conditional subtraction
+    template<std::size_t Size, typename TRed>
+        void pow2_mod_ctx(const TRed & red, const TNumTmpl<Size> & x, TNumTmpl<Size> & r) {
+            typename TRed::TElem y;
+            red.one(y);
+
+            for (auto i = nbits(x); i > 0; --i) {
+                red.sqr(y, y);
+                if (bit(x, i - 1)) {
+                    red.dbl(y);
+                }
+            }
+
+            red.from(y, r);
+        }
+
+    // call f(red) with the fastest reduction context for the modulus n:
+    // special form moduli, then Montgomery for odd n, plain mod for the rest
+    template<std::size_t Size, typename TFunc>
+        void with_reduction(const TNumTmpl<Size> & n, const TFunc & f) {
+            {
+                TSpecial<Size> red;
+                if (nbits(n) >= TSpecial<Size>::kMinBits && red.init(n)) {
+                    f(red);
+                    return;
+                }
+            }
+#ifdef GGINT_WORDS
+            {
+                TMontgomery<Size> red;
+                if (red.init(n)) {
+                    f(red);
+                    return;
+                }
+            }
+#endif
+            TModular<Size> red;
+            red.init(n);
+            f(red);
+        }
+
+    template<std::size_t Size>
+        struct TPowMod {
+            const TNumTmpl<Size> * a;
+            const TNumTmpl<Size> * x;
+            std::size_t k;
+            TNumTmpl<Size> & r;
+
+            template<typename TRed>
+                void operator()(const TRed & red) const { multi_pow_mod_ctx(red, a, x, k, r); }
+        };
+
+    template<std::size_t Size>
+        struct TPow2Mod {
+            const TNumTmpl<Size> & x;
+            TNumTmpl<Size> & r;
+
+            template<typename TRed>
+                void operator()(const TRed & red) const { pow2_mod_ctx(red, x, r); }
+        };
+
+    // r = a^x mod n, r can be a or x
+    template<std::size_t Size>
+        void pow_mod(const TNumTmpl<Size> & a, const TNumTmpl<Size> & x, const TNumTmpl<Size> & n, TNumTmpl<Size> & r) {
+            with_reduction(n, TPowMod<Size> { &a, &x, 1, r });
+        }
+
+    // r = 2^x mod n
+    template<std::size_t Size>
+        void pow2_mod(const TNumTmpl<Size> & x, const TNumTmpl<Size> & n, TNumTmpl<Size> & r) {
+            with_reduction(n, TPow2Mod<Size> { x, r });
+        }
+
+    // r = a[0]^x[0] * a[1]^x[1] * ... * a[k-1]^x[k-1] mod n
+    template<std::size_t Size>
+        void multi_pow_mod(const std::vector<TNumTmpl<Size>> & a, const std::vector<TNumTmpl<Size>> & x, const TNumTmpl<Size> & n, TNumTmpl<Size> & r) {
+            with_reduction(n, TPowMod<Size> { a.data(), x.data(), std::min(a.size(), x.size()), r });
+        }
+
+    // r = a^x * b^y mod n
+    template<std::size_t Size>
+        void multi_pow_mod(const TNumTmpl<Size> & a, const TNumTmpl<Size> & x, const TNumTmpl<Size> & b, const TNumTmpl<Size> & y, const TNumTmpl<Size> & n, TNumTmpl<Size> & r) {
+            multi_pow_mod<Size>({ a, b }, { x, y }, n, r);
+        }
+
+    // decimal representation of x
+    template<std::size_t Size>
+        std::string to_string(TNumTmpl<Size> x) {
+            // short division by 10^16, so that r*kDigitMax + digit still fits in 64 bits
+            constexpr uint64_t kChunk = 10000000000000000ull;
+
+            std::string res;
+            auto n = ndigits(x);
+            while (n > 0) {
+                uint64_t r = 0;
+                for (auto i = n; i > 0; --i) {
+                    r = r*kDigitMax + x[i - 1];
+                    x[i - 1] = r/kChunk;
+                    r %= kChunk;
+                }
+                n = ndigits(x);
+                for (int k = 0; k < 16 && (n > 0 || r > 0); ++k) {
+                    res += '0' + r % 10;
+                    r /= 10;
+                }
+            }
+            if (res.empty()) res = "0";
+
+            return std::string(res.rbegin(), res.rend());
+        }
+
+    // print number: array of bytes and decimal representation
+    template<std::size_t Size>
+        void print(const char * pref, const TNumTmpl<Size> & x, bool printBytes = true) {
+            const auto n = ndigits(x);
+
+            if (printBytes) {
+                printf(" - %16s : ", pref);
+                for (std::size_t i = 0; i < n; ++i) {
+                    printf("%3d ", x[i]);
+                }
+                printf("\n");
+                printf("   %16s : %s\n", "Decimal", to_string(x).c_str());
+            } else {
+                printf(" - %16s : %s\n", pref, to_string(x).c_str());
+            }
+        }
+
+    // number with value semantics and operators on top of the functions above
+    // products are truncated to Size digits like mul. The expressions (a*b) % m, a*a % m and a + b*c are not evaluated
+    // step by step, but lowered to mul_mod, sqr_mod and add_mul without intermediate numbers. The expression objects
+    // refer to their operands, so they should not be stored with auto
+    template<std::size_t Size>
+        struct TBigInt {
+            TNumTmpl<Size> num;
+
+            // a*b
+            struct TMulExpr {
+                const TBigInt & a;
+                const TBigInt & b;
+
+                void eval(TNumTmpl<Size> & r) const {
+                    if (&r == &a.num || &r == &b.num) {
+                        TNumTmpl<Size> t;
+                        ggint::mul(a.num, b.num, t);
+                        r = t;
+                    } else {
+                        ggint::mul(a.num, b.num, r);
+                    }
+                }
+            };
+
+            // (a*b) % m
+            struct TMulModExpr {
+                const TBigInt & a;
+                const TBigInt & b;
+                const TBigInt & m;
+
+                void eval(TNumTmpl<Size> & r) const {
+                    if (&a == &b) {
+                        ggint::sqr_mod(a.num, m.num, r);
+                    } else {
+                        ggint::mul_mod(a.num, b.num, m.num, r);
+                    }
+                }
+            };
+
+            // a + b*c
+            struct TAddMulExpr {
+                const TBigInt & a;
+                const TBigInt & b;
+                const TBigInt & c;
+
+                void eval(TNumTmpl<Size> & r) const { ggint::add_mul(a.num, b.num, c.num, r); }
+            };
+
+            TBigInt() { zero(num); }
+            TBigInt(std::size_t n) { set(num, n); }
+            TBigInt(const TNumTmpl<Size> & n) : num(n) {}
+
+            TBigInt(const TMulExpr & e)    { e.eval(num); }
+            TBigInt(const TMulModExpr & e) { e.eval(num); }
+            TBigInt(const TAddMulExpr & e) { e.eval(num); }
+
+            TBigInt & operator=(const TMulExpr & e)    { e.eval(num); return *this; }
+            TBigInt & operator=(const TMulModExpr & e) { e.eval(num); return *this; }
+            TBigInt & operator=(const TAddMulExpr & e) { e.eval(num); return *this; }
+
+            TBigInt & operator+=(const TBigInt & b)  { add(b.num, num); return *this; }
+            TBigInt & operator-=(const TBigInt & b)  { sub(b.num, num); return *this; }
+            TBigInt & operator*=(const TBigInt & b)  { TMulExpr { *this, b }.eval(num); return *this; }
+            TBigInt & operator+=(const TMulExpr & e) { add_mul(num, e.a.num, e.b.num, num); return *this; }
+
+            TBigInt & operator%=(const TBigInt & m)  { mod(m.num, num, num); return *this; }
+
+            friend TBigInt operator+(TBigInt a, const TBigInt & b) { return a += b; }
+            friend TBigInt operator-(TBigInt a, const TBigInt & b) { return a -= b; }
+
+            friend TMulExpr    operator*(const TBigInt & a, const TBigInt & b)   { return { a, b }; }
+            friend TMulModExpr operator%(const TMulExpr & e, const TBigInt & m)  { return { e.a, e.b, m }; }
+            friend TAddMulExpr operator+(const TBigInt & a, const TMulExpr & e)  { return { a, e.a, e.b }; }
+            friend TAddMulExpr operator+(const TMulExpr & e, const TBigInt & a)  { return { a, e.a, e.b }; }
+            friend TBigInt     operator+(const TMulExpr & x, const TMulExpr & y) { return TBigInt(x) + y; }
+
+            friend TBigInt operator/(const TBigInt & a, const TBigInt & b) {
+                TBigInt q, r;
+                div(b.num, a.num, q.num, r.num);
+                return q;
+            }
+
+            friend TBigInt operator%(const TBigInt & a, const TBigInt & m) {
+                TBigInt r;
+                mod(m.num, a.num, r.num);
+                return r;
+            }
+
+            friend bool operator==(const TBigInt & a, const TBigInt & b) { return equal(a.num, b.num); }
+            friend bool operator!=(const TBigInt & a, const TBigInt & b) { return !equal(a.num, b.num); }
+            friend bool operator< (const TBigInt & a, const TBigInt & b) { return less(a.num, b.num); }
+            friend bool operator<=(const TBigInt & a, const TBigInt & b) { return less_or_equal(a.num, b.num); }
+            friend bool operator> (const TBigInt & a, const TBigInt & b) { return less(b.num, a.num); }
+            friend bool operator>=(const TBigInt & a, const TBigInt & b) { return less_or_equal(b.num, a.num); }
+
+            // a^x mod n
+            friend TBigInt pow_mod(const TBigInt & a, const TBigInt & x, const TBigInt & n) {
+                TBigInt r;
+                ggint::pow_mod(a.num, x.num, n.num, r.num);
+                return r;
+            }
+
+            friend std::string to_string(const TBigInt & x) { return ggint::to_string(x.num); }
+
+            friend void print(const char * pref, const TBigInt & x, bool printBytes = true) {
+                ggint::print(pref, x.num, printBytes);
+            }
+        };
 }